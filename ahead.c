@@ -0,0 +1,161 @@
+// ahead.c                                        Daniel Kim (10/19/26)
+//
+// Parse-ahead for commands read from a file or pipe.
+//
+// A worker thread reads, lexes, parses, and compiles the lines after the one
+// being executed and passes them to main() through a bounded ring of SLOTS
+// entries, so that on a machine with a second CPU the cost of the front end
+// is hidden behind the time spent waiting for children.  The ring has one
+// producer and one consumer, each of which owns one index; entries are
+// published with release stores and seen with acquire loads.  The semaphores
+// are used only to sleep when the ring is empty or full, and the worker is
+// woken to refill it only when it is half empty.
+//
+// The worker hands over a line unparsed, and waits until main() has executed
+// it before reading on, when parsing it could depend on or interfere with
+// the commands before it: a line containing $ (lex() expands variables,
+// which commands set, and $(...) runs commands) or << (parse() may read a
+// here document).  The worker thus never reads the environment, and lex()
+// and parse() never run in both threads at once.  A line that does not parse
+// is skipped as usual, but its error message appears when the line is read
+// ahead, possibly before the output of the commands that precede it.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <sched.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "/c/cs323/Hwk4/getLine.h"
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+#define SLOTS  64                // Most lines parsed ahead
+
+typedef struct {
+    char *line;                  // Line as read (NULL at end of file)
+    int span;                    // Lines of input it was read from
+    bool parsed;                 // Lexed and parsed (else left to main())?
+    CMD *cmd;                    // Its command and program (NULL if it was
+    program *prog;               //   empty or invalid)
+} slot;
+
+static slot ring[SLOTS];
+static unsigned head = 0;        // Next slot to fill (only worker writes)
+static unsigned tail = 0;        // Next slot to empty (only main() writes)
+static sem_t ready;              // Posted when a slot is filled
+static sem_t space;              // Posted when the ring is half empty
+static sem_t resume;             // Posted when main() is done with a raw line
+static bool paused = false;      // Worker waiting on resume?  (main() only)
+
+
+
+// Append S to the ring, waiting while it is full
+static void put (slot s)
+{
+    unsigned h = head;
+    while (h - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) == SLOTS)
+        sem_wait(&space);
+    ring[h % SLOTS] = s;
+    __atomic_store_n(&head, h + 1, __ATOMIC_RELEASE);
+    sem_post(&ready);
+}
+
+
+// Remove and return the first slot in the ring, waiting while it is empty
+static slot get (void)
+{
+    unsigned t = tail;
+    while (__atomic_load_n(&head, __ATOMIC_ACQUIRE) == t)
+        sem_wait(&ready);
+    slot s = ring[t % SLOTS];
+    __atomic_store_n(&tail, t + 1, __ATOMIC_RELEASE);
+    if (__atomic_load_n(&head, __ATOMIC_ACQUIRE) - (t + 1) == SLOTS / 2)
+        sem_post(&space);                               // Refill when half
+    return s;
+}
+
+
+// Worker thread: read and parse lines until end of file
+static void *worker (void *unused)
+{
+    for ( ; ; ) {
+        slot s = { getLine(cmdInput), 1, false, NULL, NULL };
+        char *more;
+        while (s.line != NULL && incomplete(s.line) && (more = getLine(cmdInput))) {
+            s.line = joinLine(s.line, more);            // Rest of loop
+            s.span++;
+        }
+
+        if (s.line != NULL && !strchr(s.line, '$') && !strstr(s.line, "<<")) {
+            s.parsed = true;
+            token *list = NULL;
+            if (!construct(s.line, &s.cmd) && (list = lex(s.line)) != NULL) {
+                s.cmd = parse(list);
+                freeList(list);
+            }
+            if (s.cmd != NULL)
+                s.prog = compile(s.cmd);
+        }
+
+        put(s);
+        if (s.line == NULL)
+            return NULL;
+        if (!s.parsed)                                  // main() reads on
+            while (sem_wait(&resume) == -1)
+                ;
+    }
+}
+
+
+// Start parsing ahead the lines of CMDINPUT; return false if that
+// is not possible or would not help (the shell may use only one CPU)
+bool startAhead (void)
+{
+    pthread_t tid;
+    cpu_set_t cpus;
+
+    if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0 && CPU_COUNT(&cpus) < 2)
+        return false;
+    sem_init(&ready, 0, 0);
+    sem_init(&space, 0, 0);
+    sem_init(&resume, 0, 0);
+    if (pthread_create(&tid, NULL, worker, NULL) != 0)
+        return false;
+    pthread_detach(tid);
+    return true;
+}
+
+
+// Return the next line of CMDINPUT in *LINE with its command and
+// program in *CMD and *PROG, or with NULLs there if it must be lexed and
+// parsed by the caller; *LINE is NULL if the line was empty or invalid.  Set
+// *SPAN to the number of lines of input it was read from.  Return false at
+// end of file.
+bool nextParsed (char **line, CMD **cmd, program **prog, int *span)
+{
+    if (paused) {                                       // Done with last line
+        paused = false;
+        sem_post(&resume);
+    }
+
+    slot s = get();
+    if (s.line == NULL)
+        return false;
+
+    *line = s.line;
+    *cmd  = s.cmd;
+    *prog = s.prog;
+    *span = s.span;
+    if (!s.parsed)
+        paused = true;
+    else if (s.cmd == NULL) {                           // Nothing to run
+        cacheLine(s.line, NULL, s.span);
+        free(s.line);
+        *line = NULL;
+    }
+    return true;
+}
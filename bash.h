@@ -0,0 +1,169 @@
+// bash.h                                         Daniel Kim (10/19/26)
+//
+// Declarations shared among the modules of Bash (beyond those in parse.h)
+
+#include <stdbool.h>
+
+
+// history.c: persistent history and line editing
+extern FILE *cmdInput;                  // Command lines (stdin or a script)
+char *readLine (const char *prompt);    // Prompt for and read a command line
+void addHistory (const char *line);     // Append LINE to the history file
+
+
+// dircache.c: cached, sorted directory listings
+typedef struct {
+    char *name;
+    unsigned char type;                 // d_type (DT_DIR, DT_REG, ...)
+} dirEntry;
+
+typedef struct {
+    dirEntry *ent;                      // Entries sorted by name
+    size_t n;
+    char *arena;                        // Storage for the names
+} dirList;
+
+const dirList *listDir (const char *path);
+size_t lowerBound (const dirList *list, const char *key);
+
+
+// complete.c: tab completion
+char **complete (const char *line, size_t pos, size_t *start);
+
+
+// compile.c: bytecode for command lists and the script cache
+enum { OP_RUN,                          // Run leaf command CMD (SIMPLE, PIPE, SUBCMD)
+       OP_JZ,                           // Jump to ARG if last status is zero
+       OP_JNZ,                          // Jump to ARG if last status is nonzero
+       OP_BG,                           // Fork child to run block; parent jumps to ARG
+       OP_EXIT,                         // End of backgrounded block
+       OP_PAR };                        // Next ARG OP_RUNs may run concurrently
+
+typedef struct {
+    int op;
+    int arg;
+    CMD *cmd;
+} instr;
+
+typedef struct {
+    instr *code;
+    int n, max;
+    bool owned;                         // Free the commands with the program?
+} program;
+
+program *compile (CMD *c);
+void freeProgram (program *prog);
+void dumpProgram (program *prog);
+void dumpParallel (CMD *c);
+bool openCache (const char *script, int fd);
+bool nextCached (program **prog, char **line, int *span);
+void cacheLine (const char *line, program *prog, int span);
+void saveCache (void);
+
+
+// ahead.c: parse-ahead thread for scripts
+bool startAhead (void);
+bool nextParsed (char **line, CMD **cmd, program **prog, int *span);
+
+
+// process.c: execution
+int runProgram (program *prog);         // Run PROG; return its status
+extern const char *builtins[];          // Names of built-in commands
+bool isBuiltin (const char *name);      // NAME is a shell built-in?
+int dirs (CMD *pcmd, FILE *out);        // The dirs built-in
+
+
+// subst.c: command substitution
+#define HOLE  '\002'                    // Brackets a placeholder's index
+#define DEFER '\004'                    // Brackets a $(...) to run later (hex)
+char *substitute (char *line);          // Expand $(...) in LINE
+token *lexSubst (const char *text);     // lex() with $(...) outputs
+const char *holeText (const char *p, const char **end);
+token *substWord (const char *word, bool assign);
+
+
+// memo.c: the memo built-in
+void startMemo (void);
+int memo (CMD *pcmd, int (*run) (CMD *));
+
+
+// timeout.c: deadlines for foreground commands
+void startChild (void);                 // Call in child after fork()
+pid_t waitChild (pid_t pid, int *status);
+int timeout (CMD *pcmd, int (*run) (CMD *));
+
+
+// xargs.c: the xargs built-in
+int xargs (CMD *pcmd);
+
+
+// sysstats.c: accounting of the shell's system calls
+void startStats (void);
+int statsNode (int type);               // Charge calls to command type TYPE
+void statsLine (int n);                 // Charge calls to command line N
+void reportStats (void);
+
+
+// profile.c: profiling by command line and command
+bool startProfile (void);
+void profileLine (int n, CMD *cmd);     // Command line N is about to run
+void profileDone (void);                // ... and has finished
+void profileEnter (CMD *pcmd);          // Simple command PCMD is about to run
+void profileLeave (CMD *pcmd);          // ... and has finished
+void reportProfile (void);
+
+
+// meter.c: throughput meter for pipelines
+pid_t meterPipe (int fd[2], CMD *pcmd);
+
+
+// glob.c: pathname expansion
+int globCMD (CMD *pcmd, CMD *copy);     // Expand SIMPLE PCMD into *COPY
+void freeGlob (CMD *copy);
+
+
+// construct.c: command lines that parse() does not know
+#define WATCH  (SUBCMD + 1)             // watch PATH... -- list (list in left)
+#define FANOUT (SUBCMD + 2)             // left |> right
+#define FOR    (SUBCMD + 3)             // for NAME in WORD... (body in left)
+#define WHILE  (SUBCMD + 4)             // while left; do right; done
+#define UNTIL  (SUBCMD + 5)             // until left; do right; done
+bool construct (const char *text, CMD **cmd);
+bool incomplete (const char *text);     // TEXT has an unfinished loop?
+char *joinLine (char *line, char *more);
+
+
+// watch.c: the watch built-in
+int watch (CMD *pcmd, int (*run) (CMD *));
+
+
+// fanout.c: fan-out pipelines
+int fanout (CMD *pcmd, int (*run) (CMD *));
+
+
+// loop.c: loops and the variables they set
+#define MARK '\001'                     // Brackets a loop variable's name
+const char *getVar (const char *name);
+void setVar (const char *name, const char *value);
+bool bindCMD (CMD *pcmd, CMD *copy);    // Substitute loop variables
+void freeBound (CMD *copy);
+int loop (CMD *pcmd);
+
+
+// perf.c: performance counters for jobs
+void startPerf (void);
+pid_t perfFork (CMD *pcmd);             // fork() for a job, counting it
+void perfReap (pid_t pid);              // Job PID has been reaped
+void reportPerf (void);
+
+
+// jobstats.c: measurements of background jobs
+void startJobStats (void);
+double jobTime (void);                  // Now in usec (0 if not measuring)
+void jobRead (void);                    // A command line has been read
+void jobLaunched (double start, double forked);
+void jobReaped (pid_t pid);             // Background job PID reported
+void jobReapCall (double start);
+void jobWaited (double start);
+void jobLine (int n);                   // Line N done: sample the RSS
+bool reportJobStats (void);             // False if regressed
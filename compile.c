@@ -0,0 +1,707 @@
+// compile.c                                      Daniel Kim (10/19/26)
+//
+// Compiles CMD trees into flat bytecode for the loop in runProgram(), and
+// caches the compiled lines of a script on disk.
+//
+// A program is a vector of instructions.  Each SIMPLE, PIPE, or SUBCMD
+// becomes one OP_RUN; && and || become conditional jumps over their right
+// operand; ; is just concatenation; and & becomes an OP_BG that forks a child
+// to run the block up to the matching OP_EXIT while the parent jumps past it.
+//
+// Bash SCRIPT keeps the compiled form of each line of SCRIPT in SCRIPT.bc,
+// validated by the script's mtime, size, and a hash of its contents, so that
+// reruns of an unchanged script skip lex() and parse() entirely.  Lines whose
+// meaning depends on the environment when they are lexed (those containing
+// a $) are cached as text and lexed anew each time.  Every record is checked
+// before the first line runs, and a cache that is corrupt or truncated is
+// ignored (and rewritten).
+//
+// Runs of ;-separated commands that cannot interfere with each other are
+// marked by an OP_PAR so that runProgram() may start them concurrently when
+// $PARALLEL is set.  Commands qualify if they are not shell built-ins and
+// send standard output to a file, and no two of them share a file, whether
+// as an argument (which the command may write) or a redirection, unless both
+// only redirect from it.  Arguments that begin with - are taken as options.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+#define MAGIC  "BashBC4\n"       // Cache file signature and version
+
+typedef struct {                 // Cache file header (after MAGIC)
+    int64_t mtime, mtimeNsec;    // Script's mtime and size when compiled
+    int64_t size;
+    uint64_t hash;               // FNV-1a hash of the script
+} header;
+
+enum { REC_LINE, REC_PROG, REC_END };   // Cache record kinds
+
+
+
+// Append instruction OP with argument ARG and command CMD to PROG; return its
+// index
+static int emit (program *prog, int op, int arg, CMD *cmd)
+{
+    if (prog->n == prog->max) {
+        prog->max = (prog->max ? 2 * prog->max : 16);
+        prog->code = realloc(prog->code, prog->max * sizeof(instr));
+    }
+    prog->code[prog->n] = (instr) { op, arg, cmd };
+    return prog->n++;
+}
+
+
+// ==== Parallel analysis ====
+
+// Return a pointer to the first character of PATH that matters when
+// comparing it with another relative path (i.e., skipping leading ./)
+static const char *trim (const char *path)
+{
+    while (path[0] == '.' && path[1] == '/')
+        for (path += 2; *path == '/'; path++)
+            ;
+    return path;
+}
+
+
+// Return true if paths A and B are the same, ignoring ./ and repeated /
+static bool same_path (const char *a, const char *b)
+{
+    for (a = trim(a), b = trim(b); *a && *b; a++, b++) {
+        if (*a == '/' && *b == '/') {
+            while (a[1] == '/' || (a[1] == '.' && a[2] == '/'))
+                a += (a[1] == '/' ? 1 : 2);
+            while (b[1] == '/' || (b[1] == '.' && b[2] == '/'))
+                b += (b[1] == '/' ? 1 : 2);
+        } else if (*a != *b) {
+            return false;
+        }
+    }
+    return (*a == *b);
+}
+
+
+// Return true if some stage of pipeline (or SIMPLE) C names PATH as an
+// argument or redirects to it, or redirects from it and READS is true
+static bool touches (CMD *c, const char *path, bool reads)
+{
+    for ( ; c; c = (c->type == PIPE ? c->right : NULL)) {
+        CMD *s = (c->type == PIPE ? c->left : c);
+        if (s->toFile && same_path(s->toFile, path))
+            return true;
+        if (reads && s->fromFile && same_path(s->fromFile, path))
+            return true;
+        for (int i = 1; i < s->argc; i++)
+            if (s->argv[i][0] != '-' && same_path(s->argv[i], path))
+                return true;
+    }
+    return false;
+}
+
+
+// Return true if commands A and B may not run concurrently because they
+// share a file: any argument (which either may write) or redirection, other
+// than one that both only redirect from
+static bool conflict (CMD *a, CMD *b)
+{
+    for ( ; a; a = (a->type == PIPE ? a->right : NULL)) {
+        CMD *s = (a->type == PIPE ? a->left : a);
+        if (s->toFile && touches(b, s->toFile, true))
+            return true;
+        if (s->fromFile && touches(b, s->fromFile, false))
+            return true;
+        for (int i = 1; i < s->argc; i++)
+            if (s->argv[i][0] != '-' && touches(b, s->argv[i], true))
+                return true;
+    }
+    return false;
+}
+
+
+// Return why command C must run by itself, or NULL if it may run
+// concurrently with its neighbours
+static const char *serial_reason (CMD *c)
+{
+    if (c->type == SUBCMD)
+        return "subcommand";
+    if (c->type != SIMPLE && c->type != PIPE)
+        return "command list";
+
+    CMD *last = c;
+    for (CMD *p = c; p; p = (p->type == PIPE ? p->right : NULL)) {
+        CMD *s = (p->type == PIPE ? p->left : p);
+        if (s->type != SIMPLE)
+            return "subcommand in pipeline";
+        if (s->argc == 0)
+            return "no command";
+        if (isBuiltin(s->argv[0]))
+            return "built-in command";
+        last = s;
+    }
+    if (last->toType == NONE)
+        return "writes standard output";
+    return NULL;
+}
+
+
+// Return the end of the parallel group that begins with ITEM[I] among the N
+// commands in ITEM (I+1 if it must run by itself)
+static int group_end (CMD **item, int n, int i)
+{
+    int j = i + 1;
+
+    if (serial_reason(item[i]) == NULL)
+        for ( ; j < n && serial_reason(item[j]) == NULL; j++)
+            for (int k = i; k < j; k++)
+                if (conflict(item[k], item[j]) || conflict(item[j], item[k]))
+                    return j;
+    return j;
+}
+
+
+// Set *ITEM to a new array of the commands in ;-separated list C and return
+// their number
+static int sequence (CMD *c, CMD ***item)
+{
+    int n = 0;
+
+    *item = NULL;
+    for ( ; c; c = (c->type == SEP_END ? c->right : NULL)) {
+        *item = realloc(*item, (n + 1) * sizeof(CMD *));
+        (*item)[n++] = (c->type == SEP_END ? c->left : c);
+    }
+    return n;
+}
+
+
+// Print command C (SIMPLE, PIPE, or SUBCMD) on one line
+static void dump_command (CMD *c)
+{
+    for ( ; c; c = (c->type == PIPE ? c->right : NULL)) {
+        CMD *s = (c->type == PIPE ? c->left : c);
+        if (s->type == SIMPLE)
+            for (char **q = s->argv; *q; q++)
+                fprintf(stdout, "%s%s", (q > s->argv ? " " : ""), *q);
+        else
+            fprintf(stdout, "(...)");
+        if (s->fromFile)
+            fprintf(stdout, " <%s", s->fromFile);
+        if (s->toFile)
+            fprintf(stdout, " %s%s", (s->toType == RED_APP ? ">>" : ">"), s->toFile);
+        if (c->type == PIPE)
+            fprintf(stdout, " | ");
+    }
+}
+
+
+// Print the parallel analysis of each ;-separated list in command C
+void dumpParallel (CMD *c)
+{
+    CMD **item;
+    int n;
+
+    if (c == NULL || c->type == SIMPLE || c->type == PIPE || c->type == SUBCMD)
+        return;
+    if (c->type != SEP_END) {
+        dumpParallel(c->left);
+        dumpParallel(c->right);
+        return;
+    }
+
+    n = sequence(c, &item);
+    for (int i = 0, group = 0; i < n; ) {
+        int j = group_end(item, n, i);
+
+        if (j - i > 1) {
+            group++;
+            for ( ; i < j; i++) {
+                fprintf(stdout, "PARALLEL %d:  ", group);
+                dump_command(item[i]);
+                fprintf(stdout, "\n");
+            }
+        } else {
+            const char *why = serial_reason(item[i]);
+            if (why == NULL)
+                why = (j < n && serial_reason(item[j]) == NULL
+                       ? "file conflict with next command" : "no independent neighbour");
+            if (item[i]->type == SEP_AND || item[i]->type == SEP_OR
+                  || item[i]->type == SEP_BG)
+                dumpParallel(item[i]);
+            else {
+                fprintf(stdout, "SERIAL:      ");
+                dump_command(item[i]);
+                fprintf(stdout, "  (%s)\n", why);
+            }
+            i = j;
+        }
+    }
+    free(item);
+}
+
+
+
+// Append the code for command list C to PROG
+static void compile_list (program *prog, CMD *c)
+{
+    CMD **item;
+    int n;
+
+    if (c == NULL)
+        return;
+
+    switch (c->type) {
+    case SEP_END:                           // Mark runs of independent
+        n = sequence(c, &item);             //   commands with OP_PAR
+        for (int i = 0; i < n; ) {
+            int j = group_end(item, n, i);
+            if (j - i > 1)
+                emit(prog, OP_PAR, j - i, NULL);
+            for ( ; i < j; i++)
+                compile_list(prog, item[i]);
+        }
+        free(item);
+        break;
+
+    case SEP_BG: {
+        int bg = emit(prog, OP_BG, 0, NULL);
+        compile_list(prog, c->left);
+        emit(prog, OP_EXIT, 0, NULL);
+        prog->code[bg].arg = prog->n;
+        compile_list(prog, c->right);
+        break;
+    }
+
+    case SEP_AND:                           // A && B || C is a right-nested
+    case SEP_OR:                            //   chain; each operator skips
+        compile_list(prog, c->left);        //   only its right operand
+        for (CMD *p = c; p->type == SEP_AND || p->type == SEP_OR; ) {
+            CMD *operand = p->right;
+            if (operand->type == SEP_AND || operand->type == SEP_OR)
+                operand = operand->left;
+
+            int jump = emit(prog, (p->type == SEP_AND ? OP_JNZ : OP_JZ), 0, NULL);
+            compile_list(prog, operand);
+            prog->code[jump].arg = prog->n;
+
+            if (p->right == operand)
+                break;
+            p = p->right;
+        }
+        break;
+
+    default:                                // SIMPLE, PIPE, SUBCMD
+        emit(prog, OP_RUN, 0, c);
+        break;
+    }
+}
+
+
+// Return the program for command list C, whose nodes it references
+program *compile (CMD *c)
+{
+    program *prog = calloc(1, sizeof(*prog));
+    compile_list(prog, c);
+    return prog;
+}
+
+
+// Free program PROG (and the commands it owns)
+void freeProgram (program *prog)
+{
+    if (prog == NULL)
+        return;
+    if (prog->owned)
+        for (int i = 0; i < prog->n; i++)
+            freeCMD(prog->code[i].cmd);
+    free(prog->code);
+    free(prog);
+}
+
+
+// Return the name of leaf command type TYPE
+static const char *type_name (int type)
+{
+    switch (type) {
+    case PIPE:    return "PIPE";
+    case WATCH:   return "WATCH";
+    case FANOUT:  return "FANOUT";
+    case FOR:     return "FOR";
+    case WHILE:   return "WHILE";
+    case UNTIL:   return "UNTIL";
+    default:      return "SUBCMD";
+    }
+}
+
+
+// Print program PROG, one instruction per line
+void dumpProgram (program *prog)
+{
+    static const char *name[] = { "RUN", "JZ", "JNZ", "BG", "EXIT", "PAR" };
+
+    for (int i = 0; i < prog->n; i++) {
+        instr *ip = &prog->code[i];
+        fprintf(stdout, "%4d  %-4s", i, name[ip->op]);
+        if (ip->op == OP_RUN) {
+            if (ip->cmd->type == SIMPLE)
+                for (char **q = ip->cmd->argv; *q; q++)
+                    fprintf(stdout, " %s", *q);
+            else
+                fprintf(stdout, " %s", type_name(ip->cmd->type));
+        } else if (ip->op != OP_EXIT) {
+            fprintf(stdout, " %d", ip->arg);
+        }
+        fprintf(stdout, "\n");
+    }
+}
+
+
+
+// ==== Serialization ====
+
+static void put_int (FILE *fp, int32_t i)
+{
+    fwrite(&i, sizeof(i), 1, fp);
+}
+
+
+static void put_str (FILE *fp, const char *s)
+{
+    put_int(fp, (s ? (int32_t) strlen(s) : -1));
+    if (s)
+        fwrite(s, 1, strlen(s), fp);
+}
+
+
+static void put_cmd (FILE *fp, CMD *c)
+{
+    put_int(fp, (c != NULL));
+    if (c == NULL)
+        return;
+
+    put_int(fp, c->type);
+    put_int(fp, c->argc);
+    for (int i = 0; i < c->argc; i++)
+        put_str(fp, c->argv[i]);
+    put_int(fp, c->nLocal);
+    for (int i = 0; i < c->nLocal; i++) {
+        put_str(fp, c->locVar[i]);
+        put_str(fp, c->locVal[i]);
+    }
+    put_int(fp, c->fromType);
+    put_str(fp, c->fromFile);
+    put_int(fp, c->toType);
+    put_str(fp, c->toFile);
+    put_cmd(fp, c->left);
+    put_cmd(fp, c->right);
+}
+
+
+// Cursor for reading a mapped cache file
+typedef struct {
+    const char *p, *end;
+    bool bad;                    // Set on a truncated or malformed record
+} reader;
+
+
+static int32_t get_int (reader *r)
+{
+    int32_t i = 0;
+    if (r->end - r->p < (long) sizeof(i))
+        r->bad = true;
+    else {
+        memcpy(&i, r->p, sizeof(i));
+        r->p += sizeof(i);
+    }
+    return i;
+}
+
+
+// Return the string next in R, or NULL if it was written as NULL (length -1)
+static char *get_str (reader *r)
+{
+    int32_t n = get_int(r);
+    if (n < -1)
+        r->bad = true;
+    if (n < 0 || r->bad)
+        return NULL;
+    if (r->end - r->p < n) {
+        r->bad = true;
+        return NULL;
+    }
+    char *s = strndup(r->p, n);
+    r->p += n;
+    return s;
+}
+
+
+static CMD *get_cmd (reader *r)
+{
+    if (!get_int(r) || r->bad)
+        return NULL;
+
+    CMD *c = mallocCMD();
+    c->type = get_int(r);
+    if (c->type < SIMPLE || c->type > UNTIL)
+        r->bad = true;
+    int argc = get_int(r);
+    if (argc < 0 || argc > r->end - r->p)
+        argc = 0, r->bad = true;
+    c->argv = realloc(c->argv, (argc + 1) * sizeof(char *));
+    for (c->argc = 0; c->argc < argc; c->argc++) {
+        char *word = (r->bad ? NULL : get_str(r));
+        if (word == NULL)                               // (No NULL in argv[])
+            word = strdup(""), r->bad = true;
+        c->argv[c->argc] = word;
+    }
+    c->argv[c->argc] = NULL;
+
+    int nLocal = get_int(r);
+    if (nLocal < 0 || nLocal > r->end - r->p)
+        nLocal = 0, r->bad = true;
+    if (nLocal > 0) {
+        c->locVar = malloc(nLocal * sizeof(char *));
+        c->locVal = malloc(nLocal * sizeof(char *));
+        for (c->nLocal = 0; c->nLocal < nLocal; c->nLocal++) {
+            c->locVar[c->nLocal] = get_str(r);
+            c->locVal[c->nLocal] = get_str(r);
+            if (c->locVar[c->nLocal] == NULL || c->locVal[c->nLocal] == NULL)
+                r->bad = true;
+        }
+    }
+    c->fromType = get_int(r);
+    c->fromFile = get_str(r);
+    c->toType   = get_int(r);
+    c->toFile   = get_str(r);
+    c->left     = get_cmd(r);
+    c->right    = get_cmd(r);
+    return c;
+}
+
+
+static void put_program (FILE *fp, program *prog)
+{
+    put_int(fp, prog->n);
+    for (int i = 0; i < prog->n; i++) {
+        put_int(fp, prog->code[i].op);
+        put_int(fp, prog->code[i].arg);
+        if (prog->code[i].op == OP_RUN)
+            put_cmd(fp, prog->code[i].cmd);
+    }
+}
+
+
+static program *get_program (reader *r)
+{
+    int n = get_int(r);
+    program *prog = calloc(1, sizeof(*prog));
+    prog->owned = true;
+
+    for (int i = 0; i < n && !r->bad; i++) {
+        int op  = get_int(r);
+        int arg = get_int(r);
+        if (op < OP_RUN || op > OP_PAR || arg < 0 || arg > n)
+            r->bad = true;
+        emit(prog, op, arg, (op == OP_RUN ? get_cmd(r) : NULL));
+        if (op == OP_RUN && prog->code[i].cmd == NULL)
+            r->bad = true;
+    }
+    return prog;
+}
+
+
+
+// ==== Script cache ====
+
+static char *cachePath = NULL;   // SCRIPT.bc
+static header scriptHdr;         // Header describing the script as read
+static char *replay = NULL;      // Mapping of a valid cache file being replayed
+static size_t nReplay = 0;
+static reader cursor;
+static FILE *record = NULL;      // Records of the cache being built
+static char *recBuf = NULL;
+static size_t nRecBuf = 0;
+
+
+
+// Set *H to describe file FD; return false if it cannot be read
+static bool describe (int fd, header *h)
+{
+    struct stat st;
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode))
+        return false;
+
+    h->mtime     = st.st_mtim.tv_sec;
+    h->mtimeNsec = st.st_mtim.tv_nsec;
+    h->size      = st.st_size;
+    h->hash      = 14695981039346656037ULL;            // FNV-1a offset basis
+
+    if (st.st_size > 0) {
+        unsigned char *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED)
+            return false;
+        for (off_t i = 0; i < st.st_size; i++)
+            h->hash = (h->hash ^ p[i]) * 1099511628211ULL;
+        munmap(p, st.st_size);
+    }
+    return true;
+}
+
+
+// Return true if the records from R to its end are all well formed and the
+// last is REC_END (so the file was not truncated between records)
+static bool valid_records (reader r)
+{
+    while (!r.bad) {
+        int kind = get_int(&r);
+        if (kind == REC_END)
+            return (!r.bad && r.p == r.end);
+        else if (get_int(&r) < 1)                       // Span
+            r.bad = true;
+        else if (kind == REC_PROG)
+            freeProgram(get_program(&r));
+        else if (kind == REC_LINE) {
+            char *line = get_str(&r);
+            if (line == NULL)
+                r.bad = true;
+            free(line);
+        } else
+            r.bad = true;
+    }
+    return !r.bad;
+}
+
+
+// Prepare to run script SCRIPT, open on descriptor FD.  Return true if its
+// compiled lines can be replayed from SCRIPT.bc with nextCached(); otherwise
+// compiled lines are recorded with cacheLine() and saved by saveCache().
+bool openCache (const char *script, int fd)
+{
+    if (!describe(fd, &scriptHdr))
+        return false;
+    char *full = realpath(script, NULL);                // The script may cd
+    if (full == NULL || asprintf(&cachePath, "%s.bc", full) == -1) {
+        free(full);
+        cachePath = NULL;
+        return false;
+    }
+    free(full);
+
+    int cfd = open(cachePath, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (cfd != -1 && fstat(cfd, &st) == 0
+          && st.st_size >= (off_t) (sizeof(MAGIC) - 1 + sizeof(header))) {
+        char *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, cfd, 0);
+        if (p != MAP_FAILED) {
+            header h;
+            memcpy(&h, p + sizeof(MAGIC) - 1, sizeof(h));
+            if (memcmp(p, MAGIC, sizeof(MAGIC) - 1) == 0
+                  && memcmp(&h, &scriptHdr, sizeof(h)) == 0) {
+                replay = p;
+                nReplay = st.st_size;
+                cursor = (reader) { p + sizeof(MAGIC) - 1 + sizeof(h),
+                                    p + st.st_size, false };
+            }
+            if (replay != NULL && !valid_records(cursor)) {     // Recompile
+                fprintf(stderr, "%s: corrupt cache, ignored\n", cachePath);
+                replay = NULL;
+            }
+            if (replay == NULL)
+                munmap(p, st.st_size);
+        }
+    }
+    if (cfd != -1)
+        close(cfd);
+
+    if (replay == NULL)
+        record = open_memstream(&recBuf, &nRecBuf);
+    return (replay != NULL);
+}
+
+
+// Return the next line replayed from the cache: either a program in *PROG
+// (with *LINE NULL) or a line to lex and parse in *LINE (with *PROG NULL),
+// and in *SPAN the number of lines of the script that it was read from.
+// Return false at the end of the script; exit if the cache has become corrupt
+// since openCache() checked it.
+bool nextCached (program **prog, char **line, int *span)
+{
+    *prog = NULL;
+    *line = NULL;
+    if (replay == NULL || cursor.p >= cursor.end || cursor.bad)
+        return false;
+
+    int kind = get_int(&cursor);
+    if (kind == REC_END)
+        return false;
+    *span = get_int(&cursor);
+    if (kind == REC_PROG)
+        *prog = get_program(&cursor);
+    else
+        *line = get_str(&cursor);
+
+    if (cursor.bad || (*prog == NULL && *line == NULL)) {
+        fprintf(stderr, "%s: corrupt cache, remove it and rerun\n", cachePath);
+        exit(EXIT_FAILURE);
+    }
+    return true;
+}
+
+
+// Record LINE of the script being run (read from SPAN lines of it) and PROG,
+// its compiled form (or NULL if it did not parse); lines whose lexing depends
+// on the environment are kept as text
+void cacheLine (const char *line, program *prog, int span)
+{
+    if (record == NULL)
+        return;
+
+    if (prog == NULL || strchr(line, '$')) {
+        put_int(record, REC_LINE);
+        put_int(record, span);
+        put_str(record, line);
+    } else {
+        put_int(record, REC_PROG);
+        put_int(record, span);
+        put_program(record, prog);
+    }
+}
+
+
+// Write the records of a script run to end of file to SCRIPT.bc
+void saveCache (void)
+{
+    if (record == NULL)
+        return;
+    fclose(record);
+    record = NULL;
+
+    char *tmp;
+    if (asprintf(&tmp, "%s.%d", cachePath, getpid()) == -1)
+        return;
+
+    FILE *fp = fopen(tmp, "w");
+    if (fp != NULL) {
+        fwrite(MAGIC, 1, sizeof(MAGIC) - 1, fp);
+        fwrite(&scriptHdr, sizeof(scriptHdr), 1, fp);
+        fwrite(recBuf, 1, nRecBuf, fp);
+        int32_t end = REC_END;
+        fwrite(&end, sizeof(end), 1, fp);
+        if (fclose(fp) == 0 && rename(tmp, cachePath) == 0)
+            tmp[0] = '\0';
+        if (tmp[0])
+            unlink(tmp);
+    }
+    free(tmp);
+    free(recBuf);
+    recBuf = NULL;
+}
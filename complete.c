@@ -0,0 +1,268 @@
+// complete.c                                     Daniel Kim (10/19/26)
+//
+// Tab completion of command names and file paths for readLine().
+//
+// Command names come from a sorted index of the executables in the $PATH
+// directories plus the built-in commands.  The index is maintained
+// incrementally: each $PATH directory keeps its own list of names, reread
+// only when the directory's mtime changes, and the merged index is rebuilt
+// only when some list changed.  A completion is then a binary search for the
+// first name with the typed prefix.  File paths are completed from the cached
+// getdents64() listings in dircache.c.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <linux/limits.h>
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+typedef struct {
+    char *dir;                   // Directory named in $PATH
+    dev_t dev;                   // Identity and mtime when names were read
+    ino_t ino;
+    struct timespec mtime;
+    char **names;                // Executables in dir
+    size_t n;
+} pathDir;
+
+static char *pathSeen = NULL;    // Value of $PATH that pathDirs reflects
+static pathDir *pathDirs = NULL;
+static size_t nPathDirs = 0;
+
+static char **cmds = NULL;       // Sorted, deduplicated command names
+static size_t nCmds = 0;
+
+
+
+// Compare strings through pointers for qsort()
+static int by_string (const void *a, const void *b)
+{
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+
+// Reread the executables in D, whose current status is *ST
+static void load_dir (pathDir *d, const struct stat *st)
+{
+    for (size_t i = 0; i < d->n; i++)
+        free(d->names[i]);
+    free(d->names);
+    d->names = NULL;
+    d->n = 0;
+
+    d->dev   = st->st_dev;
+    d->ino   = st->st_ino;
+    d->mtime = st->st_mtim;
+
+    const dirList *list = listDir(d->dir);
+    int dfd = open(d->dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (list == NULL || dfd == -1) {
+        if (dfd != -1)
+            close(dfd);
+        return;
+    }
+
+    d->names = malloc((list->n + 1) * sizeof(char *));
+    for (size_t i = 0; i < list->n; i++) {
+        const dirEntry *e = &list->ent[i];
+        if (e->type == DT_DIR)
+            continue;
+        if (faccessat(dfd, e->name, X_OK, 0) == 0)
+            d->names[d->n++] = strdup(e->name);
+    }
+    close(dfd);
+}
+
+
+// Bring the command index up to date with $PATH and its directories
+static void update_commands (void)
+{
+    char *path = getenv("PATH");
+    bool changed = false;
+
+    if (path == NULL)
+        path = "";
+    if (pathSeen == NULL || strcmp(path, pathSeen) != 0) {
+        for (size_t i = 0; i < nPathDirs; i++) {
+            for (size_t j = 0; j < pathDirs[i].n; j++)
+                free(pathDirs[i].names[j]);
+            free(pathDirs[i].names);
+            free(pathDirs[i].dir);
+        }
+        free(pathDirs);
+        free(pathSeen);
+        pathSeen = strdup(path);
+        pathDirs = NULL;
+        nPathDirs = 0;
+
+        char *copy = strdup(path), *save, *dir;
+        for (dir = strtok_r(copy, ":", &save); dir; dir = strtok_r(NULL, ":", &save)) {
+            pathDirs = realloc(pathDirs, (nPathDirs + 1) * sizeof(pathDir));
+            pathDirs[nPathDirs++] = (pathDir) { strdup(dir), 0, 0, {0, 0}, NULL, 0 };
+        }
+        free(copy);
+        changed = true;
+    }
+
+    for (size_t i = 0; i < nPathDirs; i++) {
+        pathDir *d = &pathDirs[i];
+        struct stat st;
+        if (stat(d->dir, &st) == -1)
+            st = (struct stat) { 0 };
+        if (st.st_dev != d->dev || st.st_ino != d->ino
+              || st.st_mtim.tv_sec != d->mtime.tv_sec
+              || st.st_mtim.tv_nsec != d->mtime.tv_nsec
+              || (d->names == NULL && st.st_ino != 0)) {
+            load_dir(d, &st);
+            changed = true;
+        }
+    }
+
+    if (!changed)
+        return;
+
+    size_t n = 0;
+    for (const char **p = builtins; *p; p++)
+        n++;
+    for (size_t i = 0; i < nPathDirs; i++)
+        n += pathDirs[i].n;
+    cmds = realloc(cmds, (n + 1) * sizeof(char *));
+
+    nCmds = 0;
+    for (const char **p = builtins; *p; p++)
+        cmds[nCmds++] = (char *) *p;
+    for (size_t i = 0; i < nPathDirs; i++)
+        for (size_t j = 0; j < pathDirs[i].n; j++)
+            cmds[nCmds++] = pathDirs[i].names[j];
+    qsort(cmds, nCmds, sizeof(char *), by_string);
+
+    size_t k = 0;                                       // Drop duplicates
+    for (size_t i = 0; i < nCmds; i++)
+        if (k == 0 || strcmp(cmds[i], cmds[k-1]) != 0)
+            cmds[k++] = cmds[i];
+    nCmds = k;
+}
+
+
+// Append a copy of the N bytes at S followed by string T to *LIST of *N
+static void add_match (char ***list, size_t *n, const char *s, size_t ns,
+                       const char *t)
+{
+    size_t nt = strlen(t);
+    char *m = malloc(ns + nt + 1);
+    memcpy(m, s, ns);
+    memcpy(m + ns, t, nt + 1);
+
+    if ((*n & (*n + 1)) == 0)                           // n+1 a power of 2
+        *list = realloc(*list, (2 * *n + 2) * sizeof(char *));
+    (*list)[(*n)++] = m;
+    (*list)[*n] = NULL;
+}
+
+
+// Append the command names that begin with the N bytes at WORD to *LIST
+static void complete_command (char ***list, size_t *nList,
+                              const char *word, size_t n)
+{
+    update_commands();
+
+    size_t lo = 0, hi = nCmds;
+    while (lo < hi) {                                   // First name >= word
+        size_t mid = (lo + hi) / 2;
+        if (strncmp(cmds[mid], word, n) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for ( ; lo < nCmds && strncmp(cmds[lo], word, n) == 0; lo++)
+        add_match(list, nList, "", 0, cmds[lo]);
+}
+
+
+// Append the file paths that begin with the N bytes at WORD to *LIST
+static void complete_path (char ***list, size_t *nList,
+                           const char *word, size_t n)
+{
+    char dir[PATH_MAX], key[NAME_MAX+1];
+    const char *slash = memrchr(word, '/', n);
+    size_t nDir = (slash ? slash - word + 1 : 0);       // Typed directory part
+    size_t nBase = n - nDir;
+
+    if (nDir == 0)
+        strcpy(dir, ".");
+    else if (word[0] == '~' && word[1] == '/' && getenv("HOME"))
+        snprintf(dir, sizeof(dir), "%s/%.*s", getenv("HOME"),
+                 (int) (nDir - 2), word + 2);
+    else
+        snprintf(dir, sizeof(dir), "%.*s", (int) nDir, word);
+    if (nBase > NAME_MAX)
+        return;
+    memcpy(key, word + nDir, nBase);
+    key[nBase] = '\0';
+
+    const dirList *ls = listDir(dir);
+    if (ls == NULL)
+        return;
+
+    for (size_t i = lowerBound(ls, key); i < ls->n; i++) {
+        const dirEntry *e = &ls->ent[i];
+        if (strncmp(e->name, key, nBase) != 0)
+            break;
+        if (e->name[0] == '.' && key[0] != '.')
+            continue;
+
+        bool isDir = (e->type == DT_DIR);
+        if (e->type == DT_LNK || e->type == DT_UNKNOWN) {
+            char full[PATH_MAX + NAME_MAX + 2];
+            struct stat st;
+            snprintf(full, sizeof(full), "%s/%s", dir, e->name);
+            isDir = (stat(full, &st) == 0 && S_ISDIR(st.st_mode));
+        }
+
+        char name[NAME_MAX+2];
+        snprintf(name, sizeof(name), "%s%s", e->name, (isDir ? "/" : ""));
+        add_match(list, nList, word, nDir, name);
+    }
+}
+
+
+// Return a NULL-terminated, sorted array of completions for the word that ends
+// at position POS in LINE (NULL if there are none) and set *START to the
+// position where that word begins.  Words in command position complete to
+// command names; all others (and those containing a /) to file paths.
+char **complete (const char *line, size_t pos, size_t *start)
+{
+    char **list = NULL;
+    size_t n = 0, s = pos;
+
+    while (s > 0 && !strchr(" \t" METACHAR, line[s-1]))
+        s--;
+    *start = s;
+
+    size_t p = s;                                       // Skip back over
+    while (p > 0 && strchr(" \t", line[p-1]))           //   blanks and local
+        p--;                                            //   assignments
+    while (p > 0 && !strchr(" \t" METACHAR, line[p-1])) {
+        size_t q = p;
+        while (q > 0 && !strchr(" \t" METACHAR, line[q-1]))
+            q--;
+        if (memchr(line + q, '=', p - q) == NULL)
+            break;
+        for (p = q; p > 0 && strchr(" \t", line[p-1]); p--)
+            ;
+    }
+    bool command = (p == 0 || strchr(METACHAR, line[p-1]));
+
+    if (command && memchr(line + s, '/', pos - s) == NULL)
+        complete_command(&list, &n, line + s, pos - s);
+    else
+        complete_path(&list, &n, line + s, pos - s);
+    return list;
+}
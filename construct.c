@@ -0,0 +1,680 @@
+// construct.c                                    Daniel Kim (10/19/26)
+//
+// Command lines that parse() does not know.
+//
+//   watch [-d MS] PATH... -- command list
+//
+// is parsed into a WATCH node whose argv[] holds the words before the --
+// and whose left child is the command list, which the watch built-in reruns
+// (see watch.c).  Without the -- a line beginning with watch is an ordinary
+// command.  The list is lexed and parsed once, so $VAR and $(...) in it are
+// expanded when the line is read, not on each run.
+//
+//   producer |> branch |> branch ...
+//
+// where each side of a |> is a pipeline (a list must be in parentheses), is
+// parsed into a FANOUT node with the producer as its left child and the rest
+// as its right, as a | b | c is parsed into PIPE nodes (see fanout.c).  A
+// fan-out may be an item of a list (separated by ;, &, &&, ||, or newline),
+// in a subshell, or the command list of a watch: before parse() sees the
+// text, each fan-out is replaced by a placeholder word that encodes its text,
+// and the SIMPLE node that parse() builds for the word is then replaced by
+// the fan-out's own parse.
+//
+//   for NAME in WORD... ; do list ; done
+//   while list ; do list ; done
+//   until list ; do list ; done
+//
+// are parsed into FOR, WHILE, and UNTIL nodes (see loop.c) by a recursive
+// descent over the keywords, which hands the text between them to parse()
+// (or to the above).  Newlines may separate the commands of a loop; while
+// a loop is open, more lines are read (see incomplete()).  Loops may be
+// nested and may be mixed with other commands separated by ;, &, or newline.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+#define FAN  '\003'             // Begins the placeholder for a fan-out
+
+
+
+// Does TEXT begin with the word WORD?
+static bool keyword (const char *text, const char *word)
+{
+    size_t n = strlen(word);
+    return strncmp(text, word, n) == 0 && (text[n] == '\0' || strchr(" \t\n", text[n]));
+}
+
+
+// Return the length of the word at P (up to a blank or a metacharacter)
+static size_t word_len (const char *p)
+{
+    return strcspn(p, " \t\n" METACHAR);
+}
+
+
+// Is the word at P the keyword WORD?
+static bool is_kw (const char *p, const char *word)
+{
+    size_t n = word_len(p);
+    return n == strlen(word) && strncmp(p, word, n) == 0;
+}
+
+
+// Does the word at P begin a loop?
+static bool loop_kw (const char *p)
+{
+    return is_kw(p, "for") || is_kw(p, "while") || is_kw(p, "until");
+}
+
+
+// Return the number of loops begun in TEXT less the number ended, and set
+// *ANY if any is begun (keywords count only where a command may begin)
+static int count_loops (const char *text, bool *any)
+{
+    int open = 0;
+    bool start = true;                                  // Command may begin?
+
+    *any = false;
+    for (const char *p = text; *p; ) {
+        if (strchr(" \t", *p)) {
+            p++;
+        } else if (strchr("\n;&|(", *p)) {
+            start = true;
+            p++;
+        } else if (strchr(")<>", *p)) {
+            start = false;
+            p++;
+        } else {
+            if (start && loop_kw(p)) {
+                open++;
+                *any = true;
+                start = !is_kw(p, "for");               // (NAME follows for)
+            } else if (start && is_kw(p, "done")) {
+                open--;
+                start = false;
+            } else
+                start = (start && is_kw(p, "do"));
+            p += word_len(p);
+        }
+    }
+    return open;
+}
+
+
+// Is TEXT the start of a loop that is not yet complete?
+bool incomplete (const char *text)
+{
+    bool any;
+    return count_loops(text, &any) > 0;
+}
+
+
+// Return LINE followed by a newline and MORE, freeing both
+char *joinLine (char *line, char *more)
+{
+    size_t n = strlen(line);
+    line = realloc(line, n + strlen(more) + 2);
+    line[n] = '\n';
+    strcpy(line + n + 1, more);
+    free(more);
+    return line;
+}
+
+
+// Return the position of the word -- in TEXT, or NULL if there is none
+static const char *find_dashes (const char *text)
+{
+    for (const char *p = strstr(text, "--"); p; p = strstr(p + 1, "--"))
+        if (strchr(" \t", p[-1]) && (p[2] == '\0' || strchr(" \t\n", p[2])))
+            return p;
+    return NULL;
+}
+
+
+// ==== Fan-out ====
+
+// Return the first |> in the N bytes at TEXT that is not in parentheses, or
+// NULL if there is none
+static const char *find_arrow (const char *text, size_t n)
+{
+    int depth = 0;
+
+    for (const char *p = text; p + 1 < text + n; p++) {
+        if (*p == '(')
+            depth++;
+        else if (*p == ')')
+            depth--;
+        else if (depth == 0 && p[0] == '|' && p[1] == '>')
+            return p;
+    }
+    return NULL;
+}
+
+
+// Return the ) that closes the ( at P (before END), or NULL
+static const char *matching (const char *p, const char *end)
+{
+    int depth = 0;
+
+    for ( ; p < end; p++)
+        if (*p == '(')
+            depth++;
+        else if (*p == ')' && --depth == 0)
+            return p;
+    return NULL;
+}
+
+
+static void hoist_list (FILE *out, const char *text, size_t n);
+
+
+// Write the N bytes at TEXT, a pipeline, to OUT: as a placeholder if it is a
+// fan-out, else with the lists in its parentheses hoisted
+static void hoist_pipeline (FILE *out, const char *text, size_t n)
+{
+    const char *end = text + n, *close;
+
+    if (find_arrow(text, n) != NULL) {
+        fprintf(out, " %c", FAN);
+        for (const char *p = text; p < end; p++)
+            fprintf(out, "%02x", (unsigned char) *p);
+        fputc(' ', out);
+        return;
+    }
+    for (const char *p = text; p < end; p++)
+        if (*p == '(' && (close = matching(p, end)) != NULL) {
+            fputc('(', out);
+            hoist_list(out, p + 1, close - p - 1);
+            fputc(')', out);
+            p = close;
+        } else
+            fputc(*p, out);
+}
+
+
+// Write the N bytes at TEXT, a command list, to OUT with each fan-out in it
+// replaced by a placeholder
+static void hoist_list (FILE *out, const char *text, size_t n)
+{
+    const char *end = text + n, *item = text;
+    int depth = 0;
+
+    for (const char *p = text; p <= end; p++) {
+        if (p < end && *p == '(')
+            depth++;
+        else if (p < end && *p == ')')
+            depth--;
+        bool sep = (p < end && depth == 0 && (*p == ';' || *p == '\n' || *p == '&'
+                                              || (p[0] == '|' && p[1] == '|')));
+        if (p == end || sep) {
+            hoist_pipeline(out, item, p - item);
+            size_t len = (p < end && p + 1 < end && p[1] == *p ? 2 : 1);   // && ||
+            if (p < end)
+                fwrite(p, 1, len, out);
+            p += len - 1;
+            item = p + 1;
+        }
+    }
+}
+
+
+static CMD *parse_fanout (const char *text, const char *arrow);
+
+
+// Replace each placeholder node in the tree at *SLOT by its fan-out; return
+// false (after printing an error message) if one is invalid
+static bool resolve (CMD **slot)
+{
+    CMD *c = *slot;
+
+    if (c == NULL)
+        return true;
+    if (c->type != SIMPLE || c->argc == 0 || c->argv[0][0] != FAN)
+        return resolve(&c->left) && resolve(&c->right);
+
+    size_t n = strlen(c->argv[0] + 1) / 2;
+    char *text = malloc(n + 1);
+    for (size_t i = 0; i < n; i++) {
+        unsigned byte;
+        sscanf(c->argv[0] + 1 + 2 * i, "%2x", &byte);
+        text[i] = byte;
+    }
+    text[n] = '\0';
+    CMD *fan = parse_fanout(text, find_arrow(text, n));
+    free(text);
+    if (fan == NULL)
+        return false;
+    freeCMD(c);
+    *slot = fan;
+    return true;
+}
+
+
+// Return the command for the N bytes at TEXT, or NULL if they are empty or
+// invalid (after printing an error message)
+static CMD *parse_text (const char *text, size_t n)
+{
+    char *copy = NULL;
+    size_t len = 0;
+    bool fans = (memmem(text, n, "|>", 2) != NULL);
+
+    if (fans) {                                         // Hide fan-outs
+        FILE *out = open_memstream(&copy, &len);
+        hoist_list(out, text, n);
+        fclose(out);
+    } else
+        copy = strndup(text, n);
+    token *list = lexSubst(copy);
+    free(copy);
+    if (list == NULL)
+        return NULL;
+    CMD *cmd = parse(list);
+    freeList(list);
+    if (fans && !resolve(&cmd)) {
+        freeCMD(cmd);
+        return NULL;
+    }
+    return cmd;
+}
+
+
+// Return the FANOUT node for the pipelines TEXT, whose first |> is at ARROW,
+// or NULL after printing an error message
+static CMD *parse_fanout (const char *text, const char *arrow)
+{
+    CMD *stage = parse_text(text, arrow - text);
+    if (stage == NULL || (stage->type != SIMPLE && stage->type != PIPE
+                                                && stage->type != SUBCMD)) {
+        if (stage != NULL || arrow == text + strspn(text, " \t"))
+            fprintf(stderr, "fanout: each side of |> must be a pipeline\n");
+        freeCMD(stage);
+        return NULL;
+    }
+
+    text = arrow + 2;
+    arrow = find_arrow(text, strlen(text));
+    CMD *rest = (arrow ? parse_fanout(text, arrow) : parse_text(text, strlen(text)));
+    if (rest == NULL || (rest->type != SIMPLE && rest->type != PIPE
+                       && rest->type != SUBCMD && rest->type != FANOUT)) {
+        if (rest != NULL || strspn(text, " \t\n") == strlen(text))
+            fprintf(stderr, "fanout: each side of |> must be a pipeline\n");
+        freeCMD(stage);
+        freeCMD(rest);
+        return NULL;
+    }
+
+    CMD *cmd = mallocCMD();
+    cmd->type = FANOUT;
+    cmd->left = stage;
+    cmd->right = rest;
+    return cmd;
+}
+
+
+static CMD *parse_watch (const char *text, const char *dashes);
+static CMD *parse_loops (const char *text);
+
+
+// Return the command for the line TEXT, which may be a watch, a fan-out, or
+// (if LOOPS) contain loops, or NULL if it is empty or invalid
+static CMD *parse_line (const char *text, bool loops)
+{
+    const char *dashes;
+    bool any;
+
+    text += strspn(text, " \t");
+    if (loops && (count_loops(text, &any), any))
+        return parse_loops(text);
+    if (keyword(text, "watch") && (dashes = find_dashes(text)) != NULL)
+        return parse_watch(text, dashes);
+    return parse_text(text, strlen(text));             // (And fan-outs)
+}
+
+
+// Return the WATCH node for the line TEXT, whose -- is at DASHES, or NULL
+// after printing an error message
+static CMD *parse_watch (const char *text, const char *dashes)
+{
+    char *head = strndup(text, dashes - text);
+    token *words = lexSubst(head);
+    free(head);
+    for (token *t = words; t; t = t->next)
+        if (t->type != SIMPLE) {
+            fprintf(stderr, "watch: %s: not a path\n", t->text);
+            freeList(words);
+            return NULL;
+        }
+
+    if (strspn(dashes + 2, " \t\n") == strlen(dashes + 2)) {
+        fprintf(stderr, "usage: watch [-d MS] PATH... -- command list\n");
+        freeList(words);
+        return NULL;
+    }
+    CMD *body = parse_line(dashes + 2, true);
+    if (body == NULL) {
+        freeList(words);
+        return NULL;
+    }
+
+    CMD *cmd = mallocCMD();
+    cmd->type = WATCH;
+    for (token *t = words; t; t = t->next)
+        cmd->argc++;
+    cmd->argv = realloc(cmd->argv, (cmd->argc + 1) * sizeof(char *));
+    int i = 0;
+    for (token *t = words; t; t = t->next)
+        cmd->argv[i++] = strdup(t->text);
+    cmd->argv[i] = NULL;
+    cmd->left = body;
+    freeList(words);
+    return cmd;
+}
+
+
+// ==== Loops ====
+
+typedef struct {                 // State of the loop parser
+    const char *p;               // Next character
+    const char **names;          // Variables of the enclosing for loops
+    int nNames;
+    bool bad;                    // Error reported?
+} cursor;
+
+static CMD *parse_list (cursor *c, const char *stop);
+
+
+// Report syntax error MSG at cursor C; return NULL
+static CMD *syntax (cursor *c, const char *msg)
+{
+    if (!c->bad)
+        fprintf(stderr, "syntax error: %s\n", msg);
+    c->bad = true;
+    return NULL;
+}
+
+
+// Skip the blanks (and if SEPS, the ;s and newlines) at cursor C
+static void skip (cursor *c, bool seps)
+{
+    c->p += strspn(c->p, (seps ? " \t\n;" : " \t"));
+}
+
+
+// Return a copy of the N bytes at TEXT in which each $NAME or ${NAME} that
+// names the variable of an enclosing for loop is replaced by its mark, each
+// $(...) placeholder by its command list (so marked, in hex between DEFERs)
+// to be run each time the command is, and each newline that ends a command
+// by a ;
+static char *mark (cursor *c, const char *text, size_t n)
+{
+    char *out = NULL;
+    size_t size = 0;
+    char prev = '\0';                                   // Last nonblank
+    FILE *fp = open_memstream(&out, &size);
+
+    for (const char *p = text; p < text + n; ) {
+        const char *list, *end;
+        if (*p == '\n') {
+            fputc((prev && !strchr(";&|(", prev) ? ';' : ' '), fp);
+            prev = ';';
+            p++;
+            continue;
+        }
+        if ((list = holeText(p, &end)) != NULL && end <= text + n) {
+            char *inner = mark(c, list, strlen(list));
+            fputc(DEFER, fp);
+            for (char *q = inner; *q; q++)
+                fprintf(fp, "%02x", (unsigned char) *q);
+            fputc(DEFER, fp);
+            free(inner);
+            prev = DEFER;
+            p = end;
+            continue;
+        }
+
+        if (*p == '$') {
+            bool brace = (p[1] == '{');
+            const char *name = p + 1 + brace;
+            size_t len = strspn(name, "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                      "abcdefghijklmnopqrstuvwxyz0123456789_");
+            bool closed = (!brace || name[len] == '}');
+            for (int i = c->nNames - 1; i >= 0 && closed && len > 0; i--)
+                if (strlen(c->names[i]) == len && strncmp(c->names[i], name, len) == 0
+                      && name + len + brace <= text + n) {
+                    fprintf(fp, "%c%.*s%c", MARK, (int) len, name, MARK);
+                    p = name + len + brace;
+                    prev = MARK;
+                    break;
+                }
+            if (p != name - 1 - brace)
+                continue;
+        }
+        if (!strchr(" \t", *p))
+            prev = *p;
+        fputc(*p++, fp);
+    }
+    fclose(fp);
+    return out;
+}
+
+
+// Return the end of the commands at cursor C that contain no loop: the next
+// ; or newline (or just after the next &) that is followed by a loop keyword,
+// do, or done, or the end of the text
+static const char *plain_end (cursor *c)
+{
+    int depth = 0;
+
+    for (const char *p = c->p; *p; p++) {
+        if (*p == '(')
+            depth++;
+        else if (*p == ')')
+            depth--;
+        bool amp = (*p == '&' && p[1] != '&' && (p == c->p || p[-1] != '&'));
+        if (depth == 0 && (*p == ';' || *p == '\n' || amp)) {
+            const char *q = p + 1 + strspn(p + 1, " \t\n;");
+            if (loop_kw(q) || is_kw(q, "do") || is_kw(q, "done"))
+                return (amp ? p + 1 : p);
+        }
+    }
+    return c->p + strlen(c->p);
+}
+
+
+// Return list A followed by list REST, as parse() would have built it
+static CMD *join (CMD *a, CMD *rest)
+{
+    if (rest == NULL)
+        return a;
+    if ((a->type == SEP_END || a->type == SEP_BG) && a->right != NULL) {
+        a->right = join(a->right, rest);
+        return a;
+    }
+    if (a->type == SEP_BG) {
+        a->right = rest;
+        return a;
+    }
+    CMD *cmd = mallocCMD();
+    cmd->type = SEP_END;
+    cmd->left = a;
+    cmd->right = rest;
+    return cmd;
+}
+
+
+// Expect the keyword WORD at cursor C (after separators) and step over it;
+// return false (after reporting an error) if it is not there
+static bool expect (cursor *c, const char *word, const char *loop)
+{
+    char msg[64];
+
+    skip(c, true);
+    if (is_kw(c->p, word)) {
+        c->p += strlen(word);
+        return true;
+    }
+    snprintf(msg, sizeof(msg), "%s without %s", loop, word);
+    syntax(c, msg);
+    return false;
+}
+
+
+// Return the loop at cursor C, or NULL after reporting an error
+static CMD *parse_loop (cursor *c)
+{
+    CMD *cmd = mallocCMD();
+    const char *loop = (is_kw(c->p, "for") ? "for"
+                        : is_kw(c->p, "while") ? "while" : "until");
+    c->p += strlen(loop);
+
+    if (*loop == 'f') {
+        cmd->type = FOR;
+        skip(c, false);
+        size_t n = word_len(c->p);
+        if (n == 0 || (*c->p >= '0' && *c->p <= '9')
+              || strspn(c->p, "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                              "abcdefghijklmnopqrstuvwxyz0123456789_") != n) {
+            freeCMD(cmd);
+            return syntax(c, "for needs a variable name");
+        }
+        char *name = strndup(c->p, n);
+        c->p += n;
+        skip(c, false);
+
+        token *words = NULL;
+        if (is_kw(c->p, "in")) {
+            c->p += 2;
+            n = strcspn(c->p, ";\n");
+            char *text = mark(c, c->p, n);
+            words = lexSubst(text);
+            free(text);
+            c->p += n;
+        }
+        int argc = 2;
+        for (token *t = words; t; t = t->next, argc++)
+            if (t->type != SIMPLE) {
+                freeList(words);
+                freeCMD(cmd);
+                free(name);
+                return syntax(c, "for words may not contain metacharacters");
+            }
+        cmd->argv = realloc(cmd->argv, (argc + 1) * sizeof(char *));
+        cmd->argv[cmd->argc++] = strdup("for");
+        cmd->argv[cmd->argc++] = name;
+        for (token *t = words; t; t = t->next)
+            cmd->argv[cmd->argc++] = strdup(t->text);
+        cmd->argv[cmd->argc] = NULL;
+        freeList(words);
+
+        c->names = realloc(c->names, (c->nNames + 1) * sizeof(char *));
+        c->names[c->nNames++] = name;                   // In scope in body
+        if (expect(c, "do", loop))
+            cmd->left = parse_list(c, "done");
+        c->nNames--;
+    } else {
+        cmd->type = (*loop == 'w' ? WHILE : UNTIL);
+        cmd->left = parse_list(c, "do");
+        if (cmd->left == NULL && !c->bad)
+            syntax(c, "loop without condition");
+        if (!c->bad && expect(c, "do", loop))
+            cmd->right = parse_list(c, "done");
+    }
+
+    if (!c->bad && (*loop == 'f' ? cmd->left : cmd->right) == NULL)
+        syntax(c, "empty loop body");
+    if (!c->bad)
+        expect(c, "done", loop);
+    if (c->bad) {
+        freeCMD(cmd);
+        return NULL;
+    }
+    return cmd;
+}
+
+
+// Return the command list at cursor C that ends before the keyword STOP (or
+// at the end of the text if STOP is NULL), or NULL if it is empty or invalid
+static CMD *parse_list (cursor *c, const char *stop)
+{
+    CMD *items[64];
+    int n = 0;
+
+    for ( ; ; ) {
+        skip(c, true);
+        if (*c->p == '\0' || (stop && is_kw(c->p, stop)))
+            break;
+        if (is_kw(c->p, "do") || is_kw(c->p, "done"))
+            return syntax(c, (is_kw(c->p, "do") ? "unexpected do" : "unexpected done"));
+        if (n == sizeof(items) / sizeof(items[0]))
+            return syntax(c, "too many commands in list");
+
+        CMD *item;
+        if (loop_kw(c->p)) {
+            item = parse_loop(c);
+            skip(c, false);
+            if (item != NULL && *c->p == '&' && c->p[1] != '&') {
+                CMD *bg = mallocCMD();                  // done &
+                bg->type = SEP_BG;
+                bg->left = item;
+                item = bg;
+                c->p++;
+            } else if (item != NULL && !strchr(";\n", *c->p)) {
+                freeCMD(item);
+                item = syntax(c, "unexpected text after done");
+            }
+        } else {
+            const char *end = plain_end(c);
+            char *text = mark(c, c->p, end - c->p);
+            item = parse_line(text, false);
+            free(text);
+            c->p = end;
+            if (item == NULL)
+                c->bad = true;                          // (Reported)
+        }
+
+        if (item == NULL) {
+            while (n > 0)
+                freeCMD(items[--n]);
+            return NULL;
+        }
+        items[n++] = item;
+    }
+
+    CMD *list = NULL;
+    while (n > 0)
+        list = join(items[--n], list);
+    return list;
+}
+
+
+// Return the command for the line TEXT, which contains a loop, or NULL
+static CMD *parse_loops (const char *text)
+{
+    cursor c = { text, NULL, 0, false };
+    CMD *cmd = parse_list(&c, NULL);
+    free(c.names);
+    return (c.bad ? (freeCMD(cmd), NULL) : cmd);
+}
+
+
+
+// If TEXT is a line that parse() does not know, set *CMD to its command (NULL
+// if it is invalid) and return true; otherwise return false
+bool construct (const char *text, CMD **cmd)
+{
+    text += strspn(text, " \t");
+    bool loops;
+
+    if ((count_loops(text, &loops), loops) || strstr(text, "|>")
+          || (keyword(text, "watch") && find_dashes(text) != NULL)) {
+        *cmd = parse_line(text, true);
+        return true;
+    }
+    return false;
+}
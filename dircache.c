@@ -0,0 +1,174 @@
+// dircache.c                                     Daniel Kim (10/19/26)
+//
+// Cache of directory listings for completion and pathname expansion.
+//
+// Listings are read with getdents64() into large buffers, sorted once, and
+// kept keyed by device and inode.  A cached listing is reused for as long as
+// the directory's mtime, ctime, and size are unchanged, so repeated lookups in
+// the same directory cost one stat() rather than one read per entry.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+#define DENTS_BUF  (1 << 20)     // Bytes requested per getdents64()
+#define NCACHE     64            // Directories kept
+
+struct linux_dirent64 {          // Not exported by glibc headers
+    uint64_t       d_ino;
+    int64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
+
+typedef struct {
+    dev_t dev;                   // Key
+    ino_t ino;
+    struct timespec mtime, ctime;// Validators
+    off_t size;
+    unsigned long used;          // Clock for LRU replacement
+    dirList list;
+} slot;
+
+static slot cache[NCACHE];
+static unsigned long clock_;
+
+
+
+// Order directory entries by name
+static int by_name (const void *a, const void *b)
+{
+    return strcmp(((const dirEntry *) a)->name, ((const dirEntry *) b)->name);
+}
+
+
+// Read the directory open on FD into *LIST (entries other than . and ..)
+static bool read_dir (int fd, dirList *list)
+{
+    char *buf = malloc(DENTS_BUF);
+    size_t nArena = 0, maxArena = 0, maxEnt = 0;
+    char *arena = NULL;
+    long n;
+
+    list->n = 0;
+    list->ent = NULL;
+
+    while ((n = syscall(SYS_getdents64, fd, buf, DENTS_BUF)) > 0) {
+        for (long off = 0; off < n; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *) (buf + off);
+            off += d->d_reclen;
+            if (d->d_name[0] == '.' && (d->d_name[1] == '\0'
+                  || (d->d_name[1] == '.' && d->d_name[2] == '\0')))
+                continue;
+
+            size_t len = strlen(d->d_name) + 1;
+            if (nArena + len > maxArena) {
+                maxArena = 2 * (nArena + len) + 4096;
+                arena = realloc(arena, maxArena);
+            }
+            if (list->n == maxEnt) {
+                maxEnt = (maxEnt ? 2 * maxEnt : 256);
+                list->ent = realloc(list->ent, maxEnt * sizeof(dirEntry));
+            }
+            memcpy(arena + nArena, d->d_name, len);
+            list->ent[list->n].name = (char *) nArena;  // Rebased below
+            list->ent[list->n].type = d->d_type;
+            list->n++;
+            nArena += len;
+        }
+    }
+    free(buf);
+
+    if (n < 0) {
+        free(arena);
+        free(list->ent);
+        list->ent = NULL;
+        list->n = 0;
+        return false;
+    }
+
+    for (size_t i = 0; i < list->n; i++)                // Arena may have moved
+        list->ent[i].name = arena + (size_t) list->ent[i].name;
+    list->arena = arena;
+    qsort(list->ent, list->n, sizeof(dirEntry), by_name);
+    return true;
+}
+
+
+// Return the (sorted) listing of directory PATH, or NULL if it cannot be read.
+// The listing may be freed by any later call.
+const dirList *listDir (const char *path)
+{
+    struct stat st;
+    slot *s, *victim = &cache[0];
+
+    if (stat(path, &st) == -1 || !S_ISDIR(st.st_mode))
+        return NULL;
+
+    for (s = cache; s < cache + NCACHE; s++) {
+        if (s->used && s->dev == st.st_dev && s->ino == st.st_ino)
+            break;
+        if (s->used < victim->used)
+            victim = s;
+    }
+
+    if (s < cache + NCACHE) {
+        if (s->mtime.tv_sec == st.st_mtim.tv_sec
+              && s->mtime.tv_nsec == st.st_mtim.tv_nsec
+              && s->ctime.tv_sec == st.st_ctim.tv_sec
+              && s->ctime.tv_nsec == st.st_ctim.tv_nsec
+              && s->size == st.st_size) {
+            s->used = ++clock_;
+            return &s->list;
+        }
+        victim = s;                                     // Stale
+    }
+
+    if (victim->used) {
+        free(victim->list.arena);
+        free(victim->list.ent);
+        victim->used = 0;
+    }
+
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1)
+        return NULL;
+    bool ok = read_dir(fd, &victim->list);
+    close(fd);
+    if (!ok)
+        return NULL;
+
+    victim->dev   = st.st_dev;
+    victim->ino   = st.st_ino;
+    victim->mtime = st.st_mtim;
+    victim->ctime = st.st_ctim;
+    victim->size  = st.st_size;
+    victim->used  = ++clock_;
+    return &victim->list;
+}
+
+
+// Return the index of the first entry of LIST whose name is >= KEY
+size_t lowerBound (const dirList *list, const char *key)
+{
+    size_t lo = 0, hi = list->n;
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (strcmp(list->ent[mid].name, key) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
@@ -0,0 +1,278 @@
+// fanout.c                                       Daniel Kim (10/19/26)
+//
+// Fan-out pipelines.
+//
+//   producer |> branch |> branch ...
+//
+// runs the pipeline producer with its standard output read by the shell, and
+// each pipeline branch with its standard input a pipe through which it sees
+// everything that the producer writes.  For example,
+//
+//   cat access.log |> gzip > log.gz |> index-log |> grep ERROR > alerts
+//
+// The shell does not copy the data: it duplicates what the producer has
+// written into the pipes of all but the last branch with tee(), which only
+// adds references to the pages in the producer's pipe, and then moves it into
+// the last with splice().  A branch whose pipe is full holds up the producer
+// and so all of the branches (backpressure), and a branch that exits early is
+// dropped.  When tee() duplicates only part of what is in the producer's pipe
+// (the branch's pipe filled up), the rest is copied to a spare pipe, in which
+// what was already sent is discarded, and is moved from there, so that every
+// branch sees every byte exactly once.
+//
+// The status is that of the first branch that failed, or else that of the
+// producer.  If any stage failed, the status of each is reported on stderr:
+//
+//   fanout: cat 0 |> gzip 0, index-log 127, grep 1
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+#define CHUNK  (64 * 1024)       // Most bytes duplicated at once
+
+typedef struct {                 // A stage of the fan-out
+    CMD *cmd;
+    pid_t pid;
+    int fd;                      // Branch: write end of its pipe (-1 if gone)
+    int status;
+} stage;
+
+
+
+// Return the name of the first command in stage C
+static const char *stage_name (CMD *c)
+{
+    while (c->type == PIPE)
+        c = c->left;
+    return (c->type == SIMPLE ? c->argv[0] : "(...)");
+}
+
+
+// Move N bytes from IN to OUT, blocking while OUT is full; return the number
+// that could not be moved because OUT's reader has gone (0 if none)
+static size_t move (int in, int out, size_t n)
+{
+    while (n > 0) {
+        ssize_t moved = splice(in, NULL, out, NULL, n, SPLICE_F_MOVE);
+        if (moved > 0)
+            n -= moved;
+        else if (moved == 0 || errno != EINTR)
+            break;
+    }
+    return n;
+}
+
+
+// Send the N bytes at the head of pipe IN to pipe OUT without removing them;
+// SPARE (an empty pipe as large as IN) and NUL (/dev/null) are used when OUT
+// has room for only part of them.  Return false if OUT's reader has gone.
+static bool duplicate (int in, int out, size_t n, int spare[2], int nul)
+{
+    ssize_t sent;
+    while ((sent = tee(in, out, n, 0)) == -1 && errno == EINTR)
+        ;
+    if (sent < 0)
+        return false;
+    if ((size_t) sent == n)
+        return true;
+
+    // Copy the whole head, discard what was sent, and move the rest
+    ssize_t copied = tee(in, spare[1], n, 0);
+    if (copied <= sent) {
+        move(spare[0], nul, (copied > 0 ? copied : 0));
+        return false;
+    }
+    move(spare[0], nul, sent);
+    size_t left = move(spare[0], out, copied - sent);
+    move(spare[0], nul, left);                          // (Reader gone)
+    return left == 0;
+}
+
+
+// Copy everything read from IN to each of the N branches in B[], dropping
+// those whose readers have gone, until end of file or until none are left
+static void distribute (int in, stage *b, int n)
+{
+    int spare[2], nul = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+    if (pipe2(spare, O_CLOEXEC) == -1 || nul == -1) {
+        perror("fanout: pipe failed");
+        return;
+    }
+    int size = fcntl(in, F_GETPIPE_SZ);                 // (Same as IN's by
+    if (size > 0)                                       //   default)
+        fcntl(spare[1], F_SETPIPE_SZ, size);
+
+    for ( ; ; ) {
+        int last = -1, live = 0;
+        for (int i = 0; i < n; i++)
+            if (b[i].fd >= 0) {
+                last = i;
+                live++;
+            }
+        if (live == 0)
+            break;
+
+        // How much is there?  (tee() into the first live branch waits for it.)
+        ssize_t len;
+        int first = (live > 1 ? 0 : last);
+        while (b[first].fd < 0)
+            first++;
+        if (live > 1)
+            len = tee(in, b[first].fd, CHUNK, 0);
+        else
+            len = splice(in, NULL, b[first].fd, NULL, CHUNK, SPLICE_F_MOVE);
+        if (len == 0)
+            break;                                      // End of file
+        if (len < 0) {
+            if (errno != EINTR) {
+                close(b[first].fd);                     // (EPIPE)
+                b[first].fd = -1;
+            }
+            continue;
+        }
+        if (live == 1)
+            continue;
+
+        for (int i = first + 1; i < n; i++) {
+            if (b[i].fd < 0)
+                continue;
+            if (i == last) {
+                size_t left = move(in, b[i].fd, len);
+                if (left > 0) {
+                    close(b[i].fd);
+                    b[i].fd = -1;
+                    move(in, nul, left);                // Still consume it
+                }
+            } else if (!duplicate(in, b[i].fd, len, spare, nul)) {
+                close(b[i].fd);
+                b[i].fd = -1;
+            }
+        }
+    }
+}
+
+
+// Fork a process to run stage S with stdin IN and stdout OUT (if not -1),
+// closing the N descriptors in FDS[] in it; return its pid
+static pid_t spawn (stage *s, int in, int out, int *fds, int n, int (*run) (CMD *))
+{
+    pid_t pid = fork();
+    if (pid < 0)
+        perror("fanout: fork failed");
+    else if (pid == 0) {
+        if (in >= 0)
+            dup2(in, 0);
+        if (out >= 0)
+            dup2(out, 1);
+        for (int i = 0; i < n; i++)
+            if (fds[i] >= 0)
+                close(fds[i]);
+        signal(SIGPIPE, SIG_DFL);
+        _exit(run(s->cmd));
+    }
+    return pid;
+}
+
+
+// Execute fan-out command PCMD in a child, running its stages with RUN;
+// return its status
+static int fan_out (CMD *pcmd, int (*run) (CMD *))
+{
+    int n = 0;
+    stage *s = NULL;                                    // Producer, branches
+
+    for (CMD *c = pcmd; ; c = c->right) {
+        s = realloc(s, (n + 2) * sizeof(stage));
+        s[n++] = (stage) { c->left, 0, -1, 0 };
+        if (c->right->type != FANOUT) {
+            s[n++] = (stage) { c->right, 0, -1, 0 };
+            break;
+        }
+    }
+
+    // fds[] holds the producer's pipe, then each branch's
+    int *fds = malloc(2 * n * sizeof(int));
+    for (int i = 0; i < n; i++)
+        if (pipe2(&fds[2*i], O_CLOEXEC) == -1) {
+            perror("fanout: pipe failed");
+            return 1;
+        }
+
+    s[0].pid = spawn(&s[0], -1, fds[1], fds, 2 * n, run);
+    for (int i = 1; i < n; i++)
+        s[i].pid = spawn(&s[i], fds[2*i], -1, fds, 2 * n, run);
+    for (int i = 0; i < n; i++)
+        if (i > 0) {
+            s[i].fd = fds[2*i+1];
+            close(fds[2*i]);
+        } else
+            close(fds[1]);
+
+    prctl(PR_SET_NAME, "fanout");
+    signal(SIGPIPE, SIG_IGN);
+    distribute(fds[0], s + 1, n - 1);
+    close(fds[0]);                                      // (Producer may get
+    for (int i = 1; i < n; i++)                         //   SIGPIPE now)
+        if (s[i].fd >= 0)
+            close(s[i].fd);
+
+    int status = 0;
+    bool failed = false;
+    for (int i = 0; i < n; i++) {
+        int st = 1;
+        if (s[i].pid > 0 && waitpid(s[i].pid, &st, 0) > 0)
+            st = (WIFEXITED(st) ? WEXITSTATUS(st) : 128+WTERMSIG(st));
+        s[i].status = st;
+        failed |= (st != 0);
+        if (i > 0 && status == 0)
+            status = st;
+    }
+    if (status == 0)
+        status = s[0].status;
+
+    if (failed) {
+        fprintf(stderr, "fanout: %s %d |>", stage_name(s[0].cmd), s[0].status);
+        for (int i = 1; i < n; i++)
+            fprintf(stderr, "%s %s %d", (i > 1 ? "," : ""),
+                    stage_name(s[i].cmd), s[i].status);
+        fprintf(stderr, "\n");
+    }
+    free(fds);
+    free(s);
+    return status;
+}
+
+
+// Execute fan-out command PCMD, running its stages with RUN; return its status
+int fanout (CMD *pcmd, int (*run) (CMD *))
+{
+    int status;
+    pid_t pid = perfFork(pcmd);
+
+    if (pid < 0) {
+        perror("fanout: fork failed");
+        return errno;
+    } else if (pid == 0) {
+        startChild();
+        _exit(fan_out(pcmd, run));
+    }
+
+    signal(SIGINT, SIG_IGN);
+    waitChild(pid, &status);
+    perfReap(pid);
+    signal(SIGINT, SIG_DFL);
+    return (WIFEXITED(status) ? WEXITSTATUS(status) : 128+WTERMSIG(status));
+}
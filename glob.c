@@ -0,0 +1,309 @@
+// glob.c                                         Daniel Kim (10/19/26)
+//
+// Pathname expansion of the arguments and redirection targets of simple
+// commands.
+//
+// A word containing *, ?, or [...] is replaced by the sorted list of paths
+// that it matches, or left as it is if there are none.  * and ? match any
+// string and any character except /, and neither matches a leading . in a
+// name.  [abc], [a-z], and [!...] (or [^...]) match one character in (or not
+// in) the set.
+//
+// Each component of a pattern is compiled to a sequence of single-character
+// tests and stars, which is matched in time proportional to the product of
+// the lengths, without recursion, by retrying only from the last star.
+// Directories are read through listDir(), which keeps sorted getdents64()
+// listings until the directories change; a component beginning with literal
+// characters is matched only against the names in the listing with that
+// prefix, which are found by binary search.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <linux/limits.h>
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+enum { G_CHAR, G_ANY, G_SET, G_STAR };
+
+typedef struct {                 // One test in a compiled pattern
+    int op;
+    unsigned char c;             // G_CHAR: the character
+    unsigned char set[32];       // G_SET: bitmap of the characters
+} gop;
+
+typedef struct {                 // Compiled pattern for one path component
+    gop *op;
+    int n;
+    char prefix[NAME_MAX+1];     // Literal characters it begins with
+} pattern;
+
+typedef struct {                 // Growable list of paths
+    char **path;
+    size_t n, max;
+} paths;
+
+
+
+// Does WORD contain a pattern character?
+static bool is_pattern (const char *word)
+{
+    return strpbrk(word, "*?[") != NULL;
+}
+
+
+// Append a copy of PATH to LIST
+static void add_path (paths *list, const char *path)
+{
+    if (list->n + 1 >= list->max) {
+        list->max = (list->max ? 2 * list->max : 16);
+        list->path = realloc(list->path, list->max * sizeof(char *));
+    }
+    list->path[list->n++] = strdup(path);
+    list->path[list->n] = NULL;
+}
+
+
+// Compile the N bytes at S into *P; return false if they contain no pattern
+// character (e.g., an unterminated [ is an ordinary character)
+static bool compile_pattern (const char *s, size_t n, pattern *p)
+{
+    bool any = false;
+
+    p->op = malloc((n + 1) * sizeof(gop));
+    p->n = 0;
+    for (size_t i = 0; i < n; i++) {
+        gop *g = &p->op[p->n++];
+        g->op = G_CHAR;
+        g->c = s[i];
+
+        if (s[i] == '*') {
+            if (p->n > 1 && p->op[p->n-2].op == G_STAR)
+                p->n--;                                 // ** is *
+            else
+                g->op = G_STAR;
+            any = true;
+        } else if (s[i] == '?') {
+            g->op = G_ANY;
+            any = true;
+        } else if (s[i] == '[') {
+            size_t j = i + 1;
+            bool negate = (j < n && (s[j] == '!' || s[j] == '^'));
+            if (negate)
+                j++;
+            size_t first = j;
+            while (j < n && (s[j] != ']' || j == first))
+                j++;
+            if (j >= n)
+                continue;                               // Literal [
+
+            memset(g->set, 0, sizeof(g->set));
+            for (size_t k = first; k < j; k++) {
+                unsigned char lo = s[k], hi = s[k];
+                if (k + 2 < j && s[k+1] == '-') {
+                    hi = s[k+2];
+                    k += 2;
+                }
+                for (unsigned c = lo; c <= hi; c++)
+                    g->set[c / 8] |= 1 << (c % 8);
+            }
+            if (negate)
+                for (int k = 0; k < 32; k++)
+                    g->set[k] = ~g->set[k];
+            g->set['/' / 8] &= ~(1 << ('/' % 8));
+            g->op = G_SET;
+            i = j;
+            any = true;
+        }
+    }
+
+    int k;
+    for (k = 0; k < p->n && k < NAME_MAX && p->op[k].op == G_CHAR; k++)
+        p->prefix[k] = p->op[k].c;
+    p->prefix[k] = '\0';
+    return any;
+}
+
+
+// Does test G match character C?
+static bool step (const gop *g, unsigned char c)
+{
+    switch (g->op) {
+    case G_CHAR: return c == g->c;
+    case G_ANY:  return true;
+    case G_SET:  return g->set[c / 8] & (1 << (c % 8));
+    default:     return false;
+    }
+}
+
+
+// Does NAME match pattern P?
+static bool match (const pattern *p, const char *name)
+{
+    int i = 0, star = -1;
+    const char *mark = NULL;
+
+    if (name[0] == '.' && (p->n == 0 || p->op[0].op != G_CHAR))
+        return false;                                   // Hidden
+
+    while (*name) {
+        if (i < p->n && p->op[i].op == G_STAR) {        // Try star as empty
+            star = i++;
+            mark = name;
+        } else if (i < p->n && step(&p->op[i], *name)) {
+            i++;
+            name++;
+        } else if (star >= 0) {                         // Star takes one more
+            i = star + 1;
+            name = ++mark;
+        } else
+            return false;
+    }
+    while (i < p->n && p->op[i].op == G_STAR)
+        i++;
+    return i == p->n;
+}
+
+
+// Is NAME (with type TYPE) in directory DIR a directory?
+static bool is_dir (const char *dir, const char *name, unsigned char type)
+{
+    if (type != DT_LNK && type != DT_UNKNOWN)
+        return type == DT_DIR;
+
+    char path[PATH_MAX];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s%s", dir, name);
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+
+// Append to LIST the paths that match the components of WORD that begin at
+// REST, in the directory whose path (ending in / unless empty) is BASE
+static void expand (const char *base, const char *rest, paths *list)
+{
+    const char *slash = strchr(rest, '/');
+    size_t n = (slash ? (size_t) (slash - rest) : strlen(rest));
+    char path[PATH_MAX];
+    pattern p;
+
+    if (!compile_pattern(rest, n, &p)) {                // Literal component
+        free(p.op);
+        if (strlen(base) + n + 2 > sizeof(path))
+            return;
+        snprintf(path, sizeof(path), "%s%.*s%s", base, (int) n, rest, (slash ? "/" : ""));
+        if (slash)
+            expand(path, slash + 1, list);
+        else if (access(path, F_OK) == 0 || *path == '\0')
+            add_path(list, path);
+        return;
+    }
+
+    const dirList *ls = listDir(*base ? base : ".");
+    if (ls != NULL) {
+        paths names = { NULL, 0, 0 };                   // Matches in base
+        size_t len = strlen(p.prefix);
+        for (size_t i = lowerBound(ls, p.prefix); i < ls->n; i++) {
+            const dirEntry *e = &ls->ent[i];
+            if (strncmp(e->name, p.prefix, len) != 0)
+                break;
+            if (match(&p, e->name) && (!slash || is_dir(base, e->name, e->type)))
+                add_path(&names, e->name);
+        }
+
+        for (size_t i = 0; i < names.n; i++) {          // (Deeper listings
+            snprintf(path, sizeof(path), "%s%s%s",      //   may replace ls)
+                     base, names.path[i], (slash ? "/" : ""));
+            if (slash)
+                expand(path, slash + 1, list);
+            else
+                add_path(list, path);
+            free(names.path[i]);
+        }
+        free(names.path);
+    }
+    free(p.op);
+}
+
+
+// Return the sorted, NULL-terminated list of paths that WORD matches, or
+// NULL if it matches none
+static char **glob_word (const char *word)
+{
+    paths list = { NULL, 0, 0 };
+
+    if (word[0] == '/')
+        expand("/", word + 1, &list);
+    else
+        expand("", word, &list);
+    return list.path;
+}
+
+
+// Set *COPY to SIMPLE command PCMD with pathname expansion applied to its
+// arguments and redirection targets, leaving PCMD unchanged; return 1 if
+// anything was expanded, 0 if nothing needs to be (*COPY is then unset), or
+// -1 if a redirection target matches more than one path
+int globCMD (CMD *pcmd, CMD *copy)
+{
+    bool any = (pcmd->fromFile && is_pattern(pcmd->fromFile))
+            || (pcmd->toFile && is_pattern(pcmd->toFile));
+    for (int i = 0; !any && i < pcmd->argc; i++)
+        any = is_pattern(pcmd->argv[i]);
+    if (!any)
+        return 0;
+
+    *copy = *pcmd;
+    copy->fromFile = copy->toFile = NULL;
+    copy->argv = malloc((pcmd->argc + 1) * sizeof(char *));
+    copy->argc = 0;
+    int max = pcmd->argc + 1;
+
+    for (int i = 0; i < pcmd->argc; i++) {
+        char **match = (is_pattern(pcmd->argv[i]) ? glob_word(pcmd->argv[i]) : NULL);
+        char *one[] = { pcmd->argv[i], NULL };
+        char **p = (match ? match : one);
+        for ( ; *p; p++) {
+            if (copy->argc + 1 >= max) {
+                max *= 2;
+                copy->argv = realloc(copy->argv, max * sizeof(char *));
+            }
+            copy->argv[copy->argc++] = (match ? *p : strdup(*p));
+        }
+        free(match);
+    }
+    copy->argv[copy->argc] = NULL;
+
+    char **target[] = { &copy->fromFile, &copy->toFile };
+    char *from[] = { pcmd->fromFile, pcmd->toFile };
+    for (int i = 0; i < 2; i++) {
+        char **match = (from[i] && is_pattern(from[i]) ? glob_word(from[i]) : NULL);
+        if (match && match[1]) {
+            fprintf(stderr, "%s: ambiguous redirect\n", from[i]);
+            for (char **p = match; *p; p++)
+                free(*p);
+            free(match);
+            freeGlob(copy);
+            return -1;
+        }
+        *target[i] = (match ? match[0] : from[i] ? strdup(from[i]) : NULL);
+        free(match);
+    }
+    return 1;
+}
+
+
+// Free the storage of a command set by globCMD()
+void freeGlob (CMD *copy)
+{
+    for (int i = 0; i < copy->argc; i++)
+        free(copy->argv[i]);
+    free(copy->argv);
+    free(copy->fromFile);
+    free(copy->toFile);
+}
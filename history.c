@@ -0,0 +1,698 @@
+// history.c                                      Daniel Kim (10/19/26)
+//
+// Persistent command history and line editing for Bash.
+//
+// History lives in an append-only file ($HISTFILE, or ~/.Bash_history) with
+// one command per line.  Every shell appends under an exclusive flock() and
+// maps the file read-only, so concurrent shells share one history without
+// tearing each other's entries.  Nothing is parsed at startup: the index of
+// line offsets is built lazily, backwards from the end of the file, only as
+// far as navigation actually reaches.
+//
+// Searches for three or more bytes (prefix with the up arrow after typing,
+// substring with ^R) use a trigram index: for each hash of three consecutive
+// bytes, the ids (in order of age) of the entries that contain it, stored as
+// varint deltas.  A search decodes the shortest list among the query's
+// trigrams and checks only those entries, newest first.  The index is built
+// by the first such search (one pass over the file) and extended as entries
+// are appended.  Shorter queries scan the entries from the newest, which
+// finds a match for one or two bytes almost at once.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <termios.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/limits.h>
+#include "/c/cs323/Hwk4/getLine.h"
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+enum { KEY_UP = 256, KEY_DOWN, KEY_RIGHT, KEY_LEFT, KEY_HOME, KEY_END };
+
+#define GRAMS  65536             // Buckets of trigram index (hashes)
+
+typedef struct {                 // Entries containing a trigram
+    unsigned char *delta;        // Varint differences between ascending ids
+    size_t len, max;
+    uint32_t count, last;        // Ids in list, and the greatest
+} postings;
+
+
+FILE *cmdInput;                  // Stream of command lines (set by main())
+static int histFd = -1;          // History file (O_APPEND), -1 if unusable
+static char *histMap = NULL;     // Read-only mapping of the history file
+static size_t histLen = 0;       // Bytes mapped
+
+// Entries present when the shell started are indexed newest first, lazily,
+// by scanning backwards from olderScan; entries appended since (by this or
+// any other shell) are indexed oldest first in newer[].
+static size_t *older = NULL, nOlder = 0, maxOlder = 0;
+static size_t olderScan = 0;     // Unindexed region of old entries is [0,olderScan)
+static size_t *newer = NULL, nNewer = 0, maxNewer = 0;
+static size_t newerScan = 0;     // newer[] covers complete lines before newerScan
+
+// Entry ids count from the oldest (0) and so do not change as entries are
+// appended; the trigram index covers ids below nGrammed.
+static postings *grams = NULL;   // NULL until the first indexed search
+static uint32_t nGrammed = 0;
+
+
+
+// Append offset OFF to the array *ARR of *N entries with capacity *MAX
+static void push_offset (size_t **arr, size_t *n, size_t *max, size_t off)
+{
+    if (*n == *max) {
+        *max = (*max ? 2 * *max : 1024);
+        *arr = realloc(*arr, *max * sizeof(**arr));
+    }
+    (*arr)[(*n)++] = off;
+}
+
+
+// Forget the trigram index
+static void free_grams (void)
+{
+    if (grams == NULL)
+        return;
+    for (int i = 0; i < GRAMS; i++)
+        free(grams[i].delta);
+    free(grams);
+    grams = NULL;
+    nGrammed = 0;
+}
+
+
+// Forget the index (history file was truncated or replaced)
+static void reset_index (void)
+{
+    free_grams();
+    nOlder = nNewer = 0;
+    olderScan = newerScan = histLen;
+    while (olderScan > 0 && histMap[olderScan-1] != '\n')   // Partial last line
+        olderScan--;
+    newerScan = olderScan;
+}
+
+
+// Bring the mapping up to date with the file, indexing lines appended since
+static void sync_history (void)
+{
+    struct stat st;
+    if (histFd < 0 || fstat(histFd, &st) == -1 || (size_t) st.st_size == histLen)
+        return;
+
+    static bool indexed = false;
+    bool shrunk = ((size_t) st.st_size < histLen);
+    if (histMap)
+        munmap(histMap, histLen);
+    histMap = NULL;
+    histLen = 0;
+
+    if (st.st_size > 0) {
+        histMap = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, histFd, 0);
+        if (histMap == MAP_FAILED) {
+            histMap = NULL;
+            return;
+        }
+        histLen = st.st_size;
+    }
+
+    if (shrunk || !indexed) {
+        reset_index();
+        indexed = true;
+        return;
+    }
+
+    // Index complete lines appended since the last sync
+    for (size_t p = newerScan; p < histLen; ) {
+        char *nl = memchr(histMap + p, '\n', histLen - p);
+        if (nl == NULL)
+            break;
+        if (nl > histMap + p)
+            push_offset(&newer, &nNewer, &maxNewer, p);
+        p = newerScan = nl - histMap + 1;
+    }
+}
+
+
+// Open the history file; called once on the first interactive prompt
+static void open_history (void)
+{
+    static bool opened = false;
+    if (opened)
+        return;
+    opened = true;
+
+    char path[PATH_MAX];
+    char *file = getenv("HISTFILE");
+    if (file == NULL) {
+        char *home = getenv("HOME");
+        if (home == NULL)
+            return;
+        snprintf(path, sizeof(path), "%s/.Bash_history", home);
+        file = path;
+    }
+
+    if ((histFd = open(file, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600)) == -1) {
+        perror(file);
+        return;
+    }
+    sync_history();
+}
+
+
+// Return a pointer to history entry K (0 = newest) and its length in *LEN,
+// or NULL if there are fewer than K+1 entries
+static char *entry (size_t k, size_t *len)
+{
+    size_t off;
+
+    if (k < nNewer)
+        off = newer[nNewer-1-k];
+    else {
+        k -= nNewer;
+        while (k >= nOlder && olderScan > 0) {     // Extend index backwards
+            size_t end = olderScan - 1;            //   (histMap[end] == '\n')
+            char *nl = (end > 0 ? memrchr(histMap, '\n', end) : NULL);
+            size_t start = (nl ? nl - histMap + 1 : 0);
+            if (start < end)
+                push_offset(&older, &nOlder, &maxOlder, start);
+            olderScan = start;
+        }
+        if (k >= nOlder)
+            return NULL;
+        off = older[k];
+    }
+
+    char *nl = memchr(histMap + off, '\n', histLen - off);
+    *len = (nl ? (size_t) (nl - histMap) : histLen) - off;
+    return histMap + off;
+}
+
+
+// Return the number of entries, indexing the offsets of all of them
+static size_t count_entries (void)
+{
+    size_t len;
+    while (olderScan > 0)
+        entry(nNewer + nOlder, &len);
+    return nNewer + nOlder;
+}
+
+
+// Return the bucket of the trigram at P
+static unsigned gram (const char *p)
+{
+    uint32_t h = ((unsigned char) p[0] << 16) | ((unsigned char) p[1] << 8)
+               | (unsigned char) p[2];
+    return (h * 2654435761u) >> 16;                     // (GRAMS buckets)
+}
+
+
+// Add entry ID to the list of each trigram in the LEN bytes at TEXT
+static void add_grams (uint32_t id, const char *text, size_t len)
+{
+    for (size_t i = 0; i + 3 <= len; i++) {
+        postings *g = &grams[gram(text + i)];
+        if (g->count > 0 && g->last == id)
+            continue;                                   // (Repeated trigram)
+        if (g->len + 5 > g->max) {
+            g->max = (g->max ? 2 * g->max : 16);
+            g->delta = realloc(g->delta, g->max);
+        }
+        for (uint32_t d = (g->count ? id - g->last : id); ; d >>= 7) {
+            g->delta[g->len++] = (d & 127) | (d >= 128 ? 128 : 0);
+            if (d < 128)
+                break;
+        }
+        g->last = id;
+        g->count++;
+    }
+}
+
+
+// Bring the trigram index up to date with the history; return the number of
+// entries
+static uint32_t update_grams (void)
+{
+    size_t total = count_entries(), len;
+
+    if (grams == NULL)
+        grams = calloc(GRAMS, sizeof(postings));
+    for ( ; nGrammed < total; nGrammed++) {
+        char *text = entry(total - 1 - nGrammed, &len);
+        add_grams(nGrammed, text, len);
+    }
+    return total;
+}
+
+
+// Return the first entry at or older than FROM that starts with (PREFIX is
+// true) or contains the N bytes at S, or -1 if there is none
+static long search (const char *s, size_t n, long from, bool prefix)
+{
+    char *text;
+    size_t len;
+
+    if (n < 3 || histMap == NULL) {                     // Scan from FROM
+        for (long k = from; k >= 0 && (text = entry(k, &len)); k++) {
+            if (prefix ? (len >= n && memcmp(text, s, n) == 0)
+                       : (memmem(text, len, s, n) != NULL))
+                return k;
+        }
+        return -1;
+    }
+
+    uint32_t total = update_grams();
+    postings *best = &grams[gram(s)];
+    for (size_t i = 1; i + 3 <= n; i++)
+        if (grams[gram(s + i)].count < best->count)
+            best = &grams[gram(s + i)];
+
+    uint32_t *id = malloc((best->count + 1) * sizeof(uint32_t));
+    const unsigned char *p = best->delta;
+    for (uint32_t i = 0, prev = 0; i < best->count; i++) {
+        uint32_t d = 0;
+        for (int shift = 0; ; shift += 7) {
+            d |= (uint32_t) (*p & 127) << shift;
+            if (!(*p++ & 128))
+                break;
+        }
+        id[i] = prev = (i ? prev + d : d);
+    }
+
+    long found = -1;
+    for (long i = (long) best->count - 1; i >= 0 && found < 0; i--) {
+        long k = (long) total - 1 - id[i];              // (Newest first)
+        if (k < from)
+            continue;
+        text = entry(k, &len);
+        if (prefix ? (len >= n && memcmp(text, s, n) == 0)
+                   : (memmem(text, len, s, n) != NULL))
+            found = k;
+    }
+    free(id);
+    return found;
+}
+
+
+// Append LINE (less trailing newline) to the history file
+void addHistory (const char *line)
+{
+    size_t n = strcspn(line, "\n");
+    size_t len;
+    char *last;
+
+    if (histFd < 0)
+        return;
+    size_t i = 0;
+    while (i < n && isspace((unsigned char) line[i]))
+        i++;
+    if (i == n)
+        return;                                         // Blank line
+
+    sync_history();
+    if ((last = entry(0, &len)) && len == n && memcmp(last, line, n) == 0)
+        return;                                         // Repeated line
+
+    char *rec = malloc(n + 2), *p = rec;
+    flock(histFd, LOCK_EX);
+    struct stat st;
+    char c;
+    if (fstat(histFd, &st) == 0 && st.st_size > 0      // Terminate a torn
+          && pread(histFd, &c, 1, st.st_size-1) == 1    //   last entry
+          && c != '\n')
+        *p++ = '\n';
+    memcpy(p, line, n);
+    p[n] = '\n';
+    if (write(histFd, rec, p - rec + n + 1) == -1)
+        perror("history: write failed");
+    flock(histFd, LOCK_UN);
+    free(rec);
+}
+
+
+
+// ==== Line editing ====
+
+typedef struct {
+    char *buf;                   // Line being edited (NUL-terminated)
+    size_t len, max;             // Length and capacity of buf
+    size_t pos;                  // Cursor position
+    const char *prompt;
+} edit;
+
+
+// Replace the contents of E by the N bytes at S, cursor at end
+static void set_line (edit *e, const char *s, size_t n)
+{
+    if (n + 1 > e->max) {
+        e->max = n + 64;
+        e->buf = realloc(e->buf, e->max);
+    }
+    memcpy(e->buf, s, n);
+    e->buf[e->len = e->pos = n] = '\0';
+}
+
+
+// Insert the N bytes at S at the cursor
+static void insert (edit *e, const char *s, size_t n)
+{
+    if (e->len + n + 1 > e->max) {
+        e->max = 2 * (e->len + n + 1);
+        e->buf = realloc(e->buf, e->max);
+    }
+    memmove(e->buf + e->pos + n, e->buf + e->pos, e->len - e->pos + 1);
+    memcpy(e->buf + e->pos, s, n);
+    e->len += n;
+    e->pos += n;
+}
+
+
+// Redraw the prompt and line, leaving the cursor at E->pos
+static void refresh (edit *e)
+{
+    char *out = NULL;
+    size_t n = 0;
+    FILE *fp = open_memstream(&out, &n);
+
+    fprintf(fp, "\r%s%s\x1b[K\r", e->prompt, e->buf);
+    size_t col = strlen(e->prompt) + e->pos;
+    if (col > 0)
+        fprintf(fp, "\x1b[%zuC", col);
+    fclose(fp);
+
+    if (write(STDOUT_FILENO, out, n) == -1)
+        ;
+    free(out);
+}
+
+
+// Complete the word before the cursor in E.  If that adds nothing and LIST is
+// true, show the possible completions below the line instead.
+static void tab (edit *e, bool list)
+{
+    size_t start;
+    char save = e->buf[e->pos];
+    e->buf[e->pos] = '\0';
+    char **match = complete(e->buf, e->pos, &start);
+    e->buf[e->pos] = save;
+
+    if (match == NULL) {
+        write(STDOUT_FILENO, "\a", 1);
+        return;
+    }
+
+    size_t n, common = strlen(match[0]);               // Longest common prefix
+    for (n = 1; match[n]; n++) {
+        size_t i = 0;
+        while (i < common && match[n][i] == match[0][i])
+            i++;
+        common = i;
+    }
+
+    if (common > e->pos - start) {
+        memmove(e->buf + start, e->buf + e->pos, e->len - e->pos + 1);
+        e->len -= e->pos - start;
+        e->pos = start;
+        insert(e, match[0], common);
+        if (n == 1 && match[0][common-1] != '/')
+            insert(e, " ", 1);
+    } else if (list && n > 1) {
+        write(STDOUT_FILENO, "\r\n", 2);
+        for (size_t i = 0; i < n && i < 100; i++)
+            printf("%s%s", match[i], (i % 4 == 3 ? "\r\n" : "\t"));
+        if (n > 100)
+            printf("... (%zu more)", n - 100);
+        printf("\r\n");
+        fflush(stdout);
+    } else {
+        write(STDOUT_FILENO, "\a", 1);
+    }
+
+    for (size_t i = 0; i < n; i++)
+        free(match[i]);
+    free(match);
+}
+
+
+// Read one byte from the terminal; return -1 on end of file or error
+static int get_key (void)
+{
+    unsigned char c;
+    ssize_t n;
+
+    while ((n = read(STDIN_FILENO, &c, 1)) == -1 && errno == EINTR)
+        ;
+    return (n == 1 ? c : -1);
+}
+
+
+// Map the rest of an escape sequence to a KEY_* code, or 0 if unknown
+static int get_escape (void)
+{
+    int c = get_key();
+    if (c != '[' && c != 'O')
+        return 0;
+    c = get_key();
+    if (isdigit(c)) {                           // ESC [ n ~
+        if (get_key() != '~')
+            return 0;
+        return (c == '1' || c == '7' ? KEY_HOME
+              : c == '4' || c == '8' ? KEY_END : 0);
+    }
+    switch (c) {
+    case 'A':  return KEY_UP;
+    case 'B':  return KEY_DOWN;
+    case 'C':  return KEY_RIGHT;
+    case 'D':  return KEY_LEFT;
+    case 'H':  return KEY_HOME;
+    case 'F':  return KEY_END;
+    }
+    return 0;
+}
+
+
+// Reverse incremental search (^R) starting from the line in E; return the
+// key that ended the search (0 to run the match, -1 on end of file)
+static int reverse_search (edit *e)
+{
+    char query[256];
+    size_t nq = 0;
+    long match = -1;
+    char *text = "";
+    size_t len = 0;
+    int c;
+
+    for (;;) {
+        char line[600];
+        snprintf(line, sizeof(line), "(reverse-i-search)`%.*s': ",
+                 (int) nq, query);
+        edit show = { strndup(text, len), len, len + 1, len, line };
+        refresh(&show);
+        free(show.buf);
+
+        if ((c = get_key()) == -1)
+            return -1;
+
+        if (c == CTRL('r')) {                       // Next older match
+            long k = (nq > 0 ? search(query, nq, match + 1, false) : -1);
+            if (k >= 0)
+                match = k;
+        } else if ((c == 127 || c == CTRL('h')) && nq > 0) {
+            nq--;
+            match = (nq > 0 ? search(query, nq, 0, false) : -1);
+        } else if (isprint(c) && nq < sizeof(query)) {
+            query[nq++] = c;
+            long k = search(query, nq, (match >= 0 ? match : 0), false);
+            if (k >= 0)
+                match = k;
+        } else if (c == CTRL('g') || c == CTRL('c')) {
+            return c;                               // Abandon search
+        } else {
+            if (match >= 0)
+                set_line(e, text, len);
+            if (c == 033)
+                c = get_escape();
+            return (c == '\r' || c == '\n' ? 0 : c);
+        }
+
+        if (match >= 0)
+            text = entry(match, &len);
+        else
+            text = "", len = 0;
+    }
+}
+
+
+// Read one line from the terminal with editing; return NULL on end of file
+static char *edit_line (const char *prompt)
+{
+    struct termios cooked, raw;
+    edit e = { NULL, 0, 0, 0, prompt };
+    char *saved = NULL;          // Line being typed before history navigation
+    size_t nSaved = 0;           // Length of the prefix matched during navigation
+    long hist = -1;              // History entry shown, -1 for the typed line
+    bool done = false, eof = false;
+    int last = 0;                // Previous key (to detect a double tab)
+
+    tcgetattr(STDIN_FILENO, &cooked);
+    raw = cooked;
+    raw.c_iflag &= ~(ICRNL | IXON);
+    raw.c_lflag &= ~(ICANON | ECHO | ISIG | IEXTEN);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+
+    set_line(&e, "", 0);
+    refresh(&e);
+
+    while (!done) {
+        int c = get_key();
+        if (c == 033)
+            c = get_escape();
+        else if (c == CTRL('r') && histMap)
+            c = reverse_search(&e);
+
+        switch (c) {
+        case -1:
+            eof = (e.len == 0);
+            done = true;
+            break;
+        case 0:                                     // Accepted search
+        case '\r':
+        case '\n':
+            done = true;
+            break;
+        case CTRL('d'):
+            if (e.len == 0) {
+                eof = done = true;
+                break;
+            }
+            if (e.pos < e.len) {
+                memmove(e.buf + e.pos, e.buf + e.pos + 1, e.len - e.pos);
+                e.len--;
+            }
+            break;
+        case CTRL('c'):                             // Discard line
+            set_line(&e, "", 0);
+            write(STDOUT_FILENO, "^C", 2);
+            done = true;
+            break;
+        case 127:
+        case CTRL('h'):
+            if (e.pos > 0) {
+                memmove(e.buf + e.pos - 1, e.buf + e.pos, e.len - e.pos + 1);
+                e.pos--;
+                e.len--;
+            }
+            break;
+        case CTRL('a'): case KEY_HOME:
+            e.pos = 0;
+            break;
+        case CTRL('e'): case KEY_END:
+            e.pos = e.len;
+            break;
+        case CTRL('b'): case KEY_LEFT:
+            if (e.pos > 0)
+                e.pos--;
+            break;
+        case CTRL('f'): case KEY_RIGHT:
+            if (e.pos < e.len)
+                e.pos++;
+            break;
+        case '\t':
+            tab(&e, last == '\t');
+            break;
+        case CTRL('k'):
+            e.buf[e.len = e.pos] = '\0';
+            break;
+        case CTRL('u'):
+            memmove(e.buf, e.buf + e.pos, e.len - e.pos + 1);
+            e.len -= e.pos;
+            e.pos = 0;
+            break;
+        case CTRL('p'): case KEY_UP:                     // Older entry with the same
+        case CTRL('n'): case KEY_DOWN: {                 //   prefix as the typed line
+            if (hist < 0) {
+                free(saved);
+                saved = strndup(e.buf, e.len);
+                nSaved = e.len;
+            }
+            long k;
+            if (c == KEY_UP || c == CTRL('p'))
+                k = search(saved, nSaved, hist + 1, true);
+            else {
+                for (k = hist - 1; k >= 0; k--) {
+                    size_t len;
+                    char *text = entry(k, &len);
+                    if (len >= nSaved && memcmp(text, saved, nSaved) == 0)
+                        break;
+                }
+            }
+            if (k >= 0) {
+                size_t len;
+                char *text = entry(k, &len);
+                set_line(&e, text, len);
+                hist = k;
+            } else if (c == KEY_DOWN || c == CTRL('n')) {
+                set_line(&e, saved, strlen(saved));
+                hist = -1;
+            }
+            break;
+        }
+        default:
+            if (isprint(c)) {
+                char ch = c;
+                insert(&e, &ch, 1);
+            }
+            break;
+        }
+        if (!done)
+            refresh(&e);
+        last = c;
+    }
+
+    refresh(&e);
+    write(STDOUT_FILENO, "\r\n", 2);
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &cooked);
+    free(saved);
+
+    if (eof) {
+        free(e.buf);
+        return NULL;
+    }
+    insert(&e, "\n", 1);                            // As getLine() would
+    e.pos = e.len;
+    return e.buf;
+}
+
+
+// Print PROMPT and read a command line from CMDINPUT, with editing and history
+// when that is a terminal; return NULL on end of file
+char *readLine (const char *prompt)
+{
+    if (!isatty(fileno(cmdInput))) {
+        fputs(prompt, stdout);
+        fflush(stdout);
+        return getLine(cmdInput);
+    }
+
+    open_history();
+    sync_history();
+    fflush(stdout);
+
+    char *line = edit_line(prompt);
+    if (line)
+        addHistory(line);
+    return line;
+}
@@ -0,0 +1,381 @@
+// jobstats.c                                     Daniel Kim (10/19/26)
+//
+// Measurements of how the shell copes with many background jobs.
+//
+// If $JOB_STATS is set, the shell measures, in microseconds,
+//
+//   launch         the time to start a backgrounded command and give the
+//                  prompt back (fork() plus the Backgrounded line)
+//   fork           the fork() alone, whose mean bounds the launch rate
+//   reap latency   the time from a background job's exit (when SIGCHLD
+//                  arrives) to its Completed line
+//   reap call      the time taken by each reap_zombies() call, which runs
+//                  before every command
+//   wait           the time taken by each wait built-in
+//   respond        the time from reading a command line to starting its
+//                  first command, which includes reaping the jobs that have
+//                  finished (how long the prompt feels unresponsive)
+//
+// and the shell's resident set size after each command line, and when it
+// exits prints their distributions on stderr and appends them to the file
+// $JOB_STATS as "name value" lines, so that it holds one block per run.  If
+// $JOB_BASELINE names such a file, the median of each value over the runs in
+// $JOB_STATS (including this one) is compared with its median there, and one
+// that is worse by more than $JOB_TOLERANCE percent (default 25) and by more
+// than 100 usec (or KB) is reported as a regression, and the shell's exit
+// status is 1.  Comparing medians of several runs, not single runs, keeps
+// the noise of a busy machine from looking like a regression, and for the
+// same reason a percentile is compared only if this run has at least 100
+// samples beyond it (200 for the p50, 10000 for the p99), so that the tails
+// of small workloads are printed but not judged.  Any script is a workload; "make stress" runs
+// stress.bash several times against a stress.baseline that make
+// stress-baseline records on the same machine.
+//
+// The exit times are recorded by a SIGCHLD handler (installed with
+// SA_RESTART) in a table indexed by pid.  Since SIGCHLDs that arrive while
+// one is pending are merged, a child that has no entry is timed from the
+// last SIGCHLD, which makes its latency an underestimate.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <time.h>
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+#define SLOTS   65536            // Exit times remembered
+#define POINTS  8                // RSS samples printed
+#define SLACK   100              // Change (usec or KB) never a regression
+#define MANY    100              // Samples beyond a percentile to compare it
+
+enum { M_LAUNCH, M_FORK, M_REAP, M_CALL, M_WAIT, M_RESPOND, NMETRICS };
+
+static const char *metricName[NMETRICS] = {
+    "launch", "fork", "reap latency", "reap call", "wait", "respond" };
+static const char *metricKey[NMETRICS] = {
+    "launch", "fork", "reap", "reapcall", "wait", "respond" };
+
+typedef struct {                 // Samples of one metric
+    double *v;
+    int n, max;
+} series;
+
+typedef struct {                 // Exit of a child
+    volatile pid_t pid;
+    volatile double t;
+} exit_t;
+
+static bool on = false;
+static exit_t exited[SLOTS];
+static volatile double lastExit = 0;
+static double lineRead = 0;      // When the line being started was read
+static series metric[NMETRICS];
+static int launched = 0, running = 0, peak = 0, reaped = 0;
+static long *rss = NULL;         // KB after each line (rss[0] at start)
+static int nRss = 0;
+
+
+
+// Return the current time in microseconds
+static double now (void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+}
+
+
+// Append V to series S
+static void add (series *s, double v)
+{
+    if (s->n == s->max) {
+        s->max = (s->max ? 2 * s->max : 256);
+        s->v = realloc(s->v, s->max * sizeof(double));
+    }
+    s->v[s->n++] = v;
+}
+
+
+// Handle SIGCHLD by recording when the child exited
+static void child_exited (int sig, siginfo_t *info, void *unused)
+{
+    exit_t *e = &exited[info->si_pid % SLOTS];
+    e->t = lastExit = now();
+    e->pid = info->si_pid;
+}
+
+
+// Return the shell's resident set size in KB
+static long resident (void)
+{
+    long pages = 0, size;
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (fp != NULL) {
+        if (fscanf(fp, "%ld %ld", &size, &pages) != 2)
+            pages = 0;
+        fclose(fp);
+    }
+    return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+
+// Start measuring if $JOB_STATS is set
+void startJobStats (void)
+{
+    struct sigaction sa;
+
+    if (getenv("JOB_STATS") == NULL)
+        return;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = child_exited;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &sa, NULL);
+    on = true;
+    jobLine(0);
+}
+
+
+// Return the current time in microseconds if measuring, else 0
+double jobTime (void)
+{
+    return (on ? now() : 0);
+}
+
+
+// The current line has started its first command (or job)
+static void responded (void)
+{
+    if (lineRead > 0) {
+        add(&metric[M_RESPOND], now() - lineRead);
+        lineRead = 0;
+    }
+}
+
+
+// A command line has just been read
+void jobRead (void)
+{
+    if (on)
+        lineRead = now();
+}
+
+
+// A backgrounded command was started at START, forked by FORKED, and
+// announced just now
+void jobLaunched (double start, double forked)
+{
+    if (!on)
+        return;
+    responded();
+    add(&metric[M_LAUNCH], now() - start);
+    add(&metric[M_FORK], forked - start);
+    launched++;
+    if (++running > peak)
+        peak = running;
+}
+
+
+// Backgrounded child PID has been reaped and reported
+void jobReaped (pid_t pid)
+{
+    if (!on)
+        return;
+    exit_t *e = &exited[pid % SLOTS];
+    if (e->pid == pid) {
+        add(&metric[M_REAP], now() - e->t);
+        e->pid = 0;
+    } else if (lastExit > 0)
+        add(&metric[M_REAP], now() - lastExit);
+    reaped++;
+    if (running > 0)
+        running--;
+}
+
+
+// A reap_zombies() call that began at START has returned
+void jobReapCall (double start)
+{
+    if (!on)
+        return;
+    add(&metric[M_CALL], now() - start);
+    responded();
+}
+
+
+// A wait built-in that began at START has returned
+void jobWaited (double start)
+{
+    if (on)
+        add(&metric[M_WAIT], now() - start);
+}
+
+
+// Command line N has finished (0 = none yet): sample the RSS
+void jobLine (int n)
+{
+    if (!on)
+        return;
+    if (n >= nRss) {
+        rss = realloc(rss, 2 * (n + 1) * sizeof(long));
+        memset(rss + nRss, 0, (2 * (n + 1) - nRss) * sizeof(long));
+        nRss = 2 * (n + 1);
+    }
+    rss[n] = resident();
+}
+
+
+// Compare doubles for qsort()
+static int by_value (const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+
+// Return the P-th percentile of sorted series S
+static double percentile (series *s, double p)
+{
+    return (s->n == 0 ? 0 : s->v[(int) (p / 100 * (s->n - 1) + 0.5)]);
+}
+
+
+// Return the contents of file NAME, or NULL if it cannot be read
+static char *slurp (const char *name)
+{
+    FILE *fp = fopen(name, "r");
+    char *text = NULL;
+    size_t len = 0;
+
+    if (fp == NULL)
+        return NULL;
+    if (getdelim(&text, &len, '\0', fp) < 0) {
+        free(text);
+        text = strdup("");
+    }
+    fclose(fp);
+    return text;
+}
+
+
+// Return the median of the values of KEY in stats TEXT, or -1 if it has none
+static double median (const char *text, const char *key)
+{
+    series s = { NULL, 0, 0 };
+    char name[64];
+    double v, m = -1;
+    int n;
+
+    while (sscanf(text, "%63s %lf%n", name, &v, &n) == 2) {
+        if (strcmp(name, key) == 0)
+            add(&s, v);
+        text += n;
+    }
+    if (s.n > 0) {
+        qsort(s.v, s.n, sizeof(double), by_value);
+        m = (s.v[(s.n - 1) / 2] + s.v[s.n / 2]) / 2;
+    }
+    free(s.v);
+    return m;
+}
+
+
+// Return true if the median of KEY in stats TEXT is at most TOLERANCE percent
+// (or SLACK) worse than in baseline BASE, else report it and return false
+static bool within (const char *text, const char *base, const char *key, double tolerance)
+{
+    double value = median(text, key), was = median(base, key);
+    if (value < 0 || was <= 0 || value <= was * (1 + tolerance / 100) || value <= was + SLACK)
+        return true;
+    fprintf(stderr, "jobs: %s regressed: median %.1f (baseline %.1f)\n", key, value, was);
+    return false;
+}
+
+
+// Print the measurements on stderr, append them to $JOB_STATS, and compare
+// the medians there with those in $JOB_BASELINE; return false if any has
+// regressed
+bool reportJobStats (void)
+{
+    if (!on)
+        return true;
+
+    // (Read the baseline first, in case it is also $JOB_STATS)
+    char *baseName = getenv("JOB_BASELINE");
+    char *base = (baseName ? slurp(baseName) : NULL);
+    if (baseName && base == NULL)
+        perror(baseName);
+    FILE *out = fopen(getenv("JOB_STATS"), "a");
+    if (out == NULL)
+        perror(getenv("JOB_STATS"));
+
+    fprintf(stderr, "\njobs: %d backgrounded, %d reaped, at most %d running\n",
+            launched, reaped, peak);
+    fprintf(stderr, "%-14s %8s %10s %10s %10s %10s  (usec)\n",
+            "", "n", "p50", "p90", "p99", "max");
+    for (int i = 0; i < NMETRICS; i++) {
+        series *s = &metric[i];
+        qsort(s->v, s->n, sizeof(double), by_value);
+        fprintf(stderr, "%-14s %8d %10.1f %10.1f %10.1f %10.1f\n", metricName[i],
+                s->n, percentile(s, 50), percentile(s, 90), percentile(s, 99),
+                (s->n ? s->v[s->n-1] : 0));
+        if (out && s->n > 0)
+            fprintf(out, "%s_p50 %.1f\n%s_p99 %.1f\n", metricKey[i],
+                    percentile(s, 50), metricKey[i], percentile(s, 99));
+    }
+
+    series *f = &metric[M_FORK];
+    double sum = 0;
+    for (int i = 0; i < f->n; i++)
+        sum += f->v[i];
+    if (sum > 0)
+        fprintf(stderr, "fork ceiling: %.0f forks/s\n", f->n / sum * 1e6);
+
+    long top = 0, last = 0;
+    int lines = 0;
+    for (int i = 0; i < nRss; i++)
+        if (rss[i] > 0) {
+            top = (rss[i] > top ? rss[i] : top);
+            last = rss[i];
+            lines = i;
+        }
+    fprintf(stderr, "RSS KB: start %ld, peak %ld, end %ld", rss[0], top, last);
+    for (int k = 1, shown = 0; k <= POINTS; k++) {          // Over time
+        int i = lines * k / POINTS;
+        while (i > shown && rss[i] == 0)
+            i--;
+        if (i > shown)
+            fprintf(stderr, "%s %d: %ld", (shown ? "," : "; after line"), i, rss[i]);
+        shown = (i > shown ? i : shown);
+    }
+    fprintf(stderr, "\n");
+    if (out) {
+        fprintf(out, "rss_peak_kb %ld\n", top);
+        fclose(out);
+    }
+
+    // Regressions against the baseline
+    char *stats = (base ? slurp(getenv("JOB_STATS")) : NULL);
+    if (stats == NULL) {
+        free(base);
+        return (baseName == NULL);
+    }
+
+    double tolerance = (getenv("JOB_TOLERANCE") ? atof(getenv("JOB_TOLERANCE")) : 25);
+    bool ok = within(stats, base, "rss_peak_kb", tolerance);
+    char key[64];
+    for (int i = 0; i < NMETRICS; i++) {
+        snprintf(key, sizeof(key), "%s_p50", metricKey[i]);
+        if (metric[i].n / 2 >= MANY)
+            ok &= within(stats, base, key, tolerance);
+        snprintf(key, sizeof(key), "%s_p99", metricKey[i]);
+        if (metric[i].n / 100 >= MANY)
+            ok &= within(stats, base, key, tolerance);
+    }
+    free(stats);
+    free(base);
+    return ok;
+}
@@ -0,0 +1,256 @@
+// loop.c                                         Daniel Kim (10/19/26)
+//
+// for, while, and until loops.
+//
+//   for NAME in WORD... ; do command list ; done
+//   while command list ; do command list ; done
+//   until command list ; do command list ; done
+//
+// (newlines may take the place of the ;s, and the shell reads lines until the
+// loop is complete).  The loop is parsed once, by construct(), into a FOR
+// node whose argv[] is for NAME WORD... and whose left child is the body, or
+// a WHILE or UNTIL node whose left child is the condition and whose right is
+// the body; each list is compiled once when the loop starts and run from the
+// same program on each pass.  A loop ends early when a command in it is
+// stopped by SIGINT.
+//
+// A loop variable is kept in the shell's own variable store, not in the
+// environment, so it is not seen by the commands that the loop runs unless
+// they name it.  When a loop is parsed, each $NAME or ${NAME} in it that
+// names the variable of an enclosing for is replaced by a mark, and each
+// $(...) by a deferred form of its command list (see subst.c); bindCMD()
+// runs the lists and replaces the marks in a command with the variable's
+// value each time the command is executed.  Other $VARs are expanded once,
+// when the loop is read.  A word that consists only of marks and whose value
+// is empty is dropped, as is one whose $(...) output is empty.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <stdbool.h>
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+#define STOPPED  (128 + SIGINT)  // Status of a command stopped by SIGINT
+
+typedef struct {                 // A shell variable
+    char *name, *value;
+} var;
+
+static var *vars = NULL;         // The variable store
+static int nVars = 0;
+
+
+
+// Return the value of shell variable NAME, or NULL if it is not set
+const char *getVar (const char *name)
+{
+    for (int i = 0; i < nVars; i++)
+        if (strcmp(vars[i].name, name) == 0)
+            return vars[i].value;
+    return NULL;
+}
+
+
+// Set shell variable NAME to VALUE
+void setVar (const char *name, const char *value)
+{
+    for (int i = 0; i < nVars; i++)
+        if (strcmp(vars[i].name, name) == 0) {
+            free(vars[i].value);
+            vars[i].value = strdup(value);
+            return;
+        }
+    vars = realloc(vars, (nVars + 1) * sizeof(var));
+    vars[nVars++] = (var) { strdup(name), strdup(value) };
+}
+
+
+// Return a copy of WORD with each mark replaced by the value of the variable
+// that it names (empty if it is not set)
+static char *bind_word (const char *word)
+{
+    size_t len = 0, max = strlen(word) + 1;
+    char *out = malloc(max);
+
+    for (const char *p = word; *p; ) {
+        const char *value = NULL, *end;
+        size_t n = 1;
+        if (*p == MARK && (end = strchr(p + 1, MARK)) != NULL) {
+            char *name = strndup(p + 1, end - p - 1);
+            value = getVar(name);
+            free(name);
+            value = (value ? value : "");
+            n = strlen(value);
+            p = end + 1;
+        } else
+            value = p++;
+
+        if (len + n + 1 > max) {
+            max = 2 * (len + n + 1);
+            out = realloc(out, max);
+        }
+        memcpy(out + len, value, n);
+        len += n;
+    }
+    out[len] = '\0';
+    return out;
+}
+
+
+// Does WORD consist only of marks?
+static bool only_marks (const char *word)
+{
+    const char *p = word, *end;
+    while (*p == MARK && (end = strchr(p + 1, MARK)) != NULL)
+        p = end + 1;
+    return p != word && *p == '\0';
+}
+
+
+// Does WORD contain a mark or a deferred $(...)?
+static bool bound (const char *word)
+{
+    return word && (strchr(word, MARK) || strchr(word, DEFER));
+}
+
+
+// Return a copy of WORD bound as one word (e.g., a redirection target)
+static char *bind_one (const char *word)
+{
+    if (!strchr(word, DEFER))
+        return bind_word(word);
+    token *words = substWord(word, true);
+    char *one = bind_word(words ? words->text : "");
+    freeList(words);
+    return one;
+}
+
+
+// Append WORD to the arguments of COPY
+static void add_arg (CMD *copy, char *word)
+{
+    copy->argv = realloc(copy->argv, (copy->argc + 2) * sizeof(char *));
+    copy->argv[copy->argc++] = word;
+}
+
+
+// Set *COPY to command PCMD with the loop variables named in its arguments,
+// redirection targets, and local variables' values replaced by their values
+// and its deferred $(...)s by their outputs, leaving PCMD unchanged; return
+// true if there were any (else *COPY is unset)
+bool bindCMD (CMD *pcmd, CMD *copy)
+{
+    bool any = bound(pcmd->fromFile) || bound(pcmd->toFile);
+    for (int i = 0; !any && i < pcmd->argc; i++)
+        any = bound(pcmd->argv[i]);
+    for (int i = 0; !any && i < pcmd->nLocal; i++)
+        any = bound(pcmd->locVal[i]);
+    if (!any)
+        return false;
+
+    *copy = *pcmd;
+    copy->argv = malloc(sizeof(char *));
+    copy->argc = 0;
+    for (int i = 0; i < pcmd->argc; i++) {
+        if (strchr(pcmd->argv[i], DEFER)) {             // Output split
+            token *words = substWord(pcmd->argv[i], false);
+            for (token *t = words; t; t = t->next)
+                add_arg(copy, bind_word(t->text));
+            freeList(words);
+            continue;
+        }
+        char *word = bind_word(pcmd->argv[i]);
+        if (*word == '\0' && only_marks(pcmd->argv[i]))
+            free(word);                                 // Dropped
+        else
+            add_arg(copy, word);
+    }
+    if (copy->argc == 0 && pcmd->argc > 0)              // (Keep a command)
+        add_arg(copy, strdup(""));
+    copy->argv[copy->argc] = NULL;
+
+    copy->fromFile = (pcmd->fromFile ? bind_one(pcmd->fromFile) : NULL);
+    copy->toFile   = (pcmd->toFile   ? bind_one(pcmd->toFile)   : NULL);
+    copy->locVal = malloc((pcmd->nLocal + 1) * sizeof(char *));
+    for (int i = 0; i < pcmd->nLocal; i++)
+        copy->locVal[i] = bind_one(pcmd->locVal[i]);
+    return true;
+}
+
+
+// Free the storage of a command set by bindCMD()
+void freeBound (CMD *copy)
+{
+    for (int i = 0; i < copy->argc; i++)
+        free(copy->argv[i]);
+    free(copy->argv);
+    free(copy->fromFile);
+    free(copy->toFile);
+    for (int i = 0; i < copy->nLocal; i++)
+        free(copy->locVal[i]);
+    free(copy->locVal);
+}
+
+
+// Run for loop PCMD; return the status of the last command run
+static int for_loop (CMD *pcmd)
+{
+    CMD bound, expanded, *words = pcmd;
+    bool isBound = bindCMD(pcmd, &bound);
+    if (isBound)
+        words = &bound;
+    int globbed = globCMD(words, &expanded);
+    if (globbed > 0)
+        words = &expanded;
+
+    int status = 0;
+    program *body = compile(pcmd->left);
+    for (int i = 2; globbed >= 0 && i < words->argc; i++) {
+        setVar(pcmd->argv[1], words->argv[i]);
+        if ((status = runProgram(body)) == STOPPED)
+            break;
+    }
+    freeProgram(body);
+
+    if (globbed > 0)
+        freeGlob(&expanded);
+    if (isBound)
+        freeBound(&bound);
+    return (globbed < 0 ? 1 : status);
+}
+
+
+// Run while or until loop PCMD; return the status of the last command run
+// in its body (0 if none)
+static int while_loop (CMD *pcmd)
+{
+    int status = 0;
+    program *cond = compile(pcmd->left);
+    program *body = compile(pcmd->right);
+
+    for ( ; ; ) {
+        int test = runProgram(cond);
+        if (test == STOPPED) {
+            status = test;
+            break;
+        }
+        if ((test == 0) != (pcmd->type == WHILE))
+            break;
+        if ((status = runProgram(body)) == STOPPED)
+            break;
+    }
+
+    freeProgram(cond);
+    freeProgram(body);
+    return status;
+}
+
+
+// Execute loop PCMD (FOR, WHILE, or UNTIL); return its status
+int loop (CMD *pcmd)
+{
+    return (pcmd->type == FOR ? for_loop(pcmd) : while_loop(pcmd));
+}
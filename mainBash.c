@@ -4,53 +4,156 @@
 // command structures, and then executes the commands as per specification.
 //
 // Bash version based on recursive descent parse tree
-// Dumps token list or CMD tree if DUMP_LIST or DUMP_TREE is set.
-
+// Dumps token list, CMD tree, or bytecode if DUMP_LIST, DUMP_TREE, or
+// DUMP_CODE is set.
+// Interactive input is edited and saved to history by readLine().
+// $(command list) is replaced by the words of its output.
+// Bash SCRIPT runs SCRIPT, keeping its compiled lines in SCRIPT.bc.
+// Input that is not a terminal is parsed ahead by a second thread.
+// The shell's own system calls are counted if SYSCALL_STATS is set.
+// PROFILE=FILE writes the time taken by each command as folded stacks.
+// PIPE_METER reports the throughput of each pipe in a pipeline.
+// watch PATH... -- list reruns list whenever a PATH changes.
+// producer |> branch |> ... feeds the output of producer to each branch.
+// for, while, and until loops are parsed once and run from the same tree.
+// PERF counts the CPU events of each job with perf_event_open().
+// JOB_STATS=FILE measures how quickly background jobs are started and reaped.
+
+#define _GNU_SOURCE
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <ctype.h>
+#include <unistd.h>
 #include "/c/cs323/Hwk4/getLine.h"
 #include "parse.h"
+#include "bash.h"
 
-int main()
+int main (int argc, char *argv[])
 {
     int nCmd = 1;                   // Command number
+    int nLine = 1;                  // Number of next input line
+    int first;                      // Number of first line of command
+    int span;                       // Input lines in command
     char *line;                     // Initial command line
+    char *text;                     // Line after command substitution
     token *list;                    // Linked list of tokens
     CMD *cmd;                       // Parsed command
-    int process (CMD *);
+    program *prog;                  // Compiled command
+    char prompt[32];                // Prompt string
+    bool cached = false;            // Replaying compiled script?
+    bool ahead = false;             // Lines parsed by parse-ahead thread?
+
+    cmdInput = stdin;
+    if (argc > 1) {                             // Bash SCRIPT reads SCRIPT
+	if ((cmdInput = fopen (argv[1], "re")) == NULL) {  // (but commands
+	    perror (argv[1]);                   //   keep the shell's
+	    return EXIT_FAILURE;                //   standard input)
+	}
+	if (!getenv ("DUMP_LIST") && !getenv ("DUMP_TREE")
+	      && !getenv ("PROFILE"))           // (which need parse trees)
+	    cached = openCache (argv[1], fileno (cmdInput));
+    }
+    startStats ();                              // Count shell's syscalls?
+    startProfile ();                            // Time lines and commands?
+    startPerf ();                               // Count jobs' events?
+    startJobStats ();                           // Time background jobs?
+    startMemo ();                               // Note shell's stdin
+    if (!cached && !isatty (fileno (cmdInput)) && !getenv ("DUMP_LIST"))
+	ahead = startAhead ();                  // Parse while commands run
 
     for ( ; ; ) {
-	printf ("(%d)$ ", nCmd);                // Prompt for command
-	fflush (stdout);
-	if ((line = getLine (stdin)) == NULL)   // Read line
-	    break;                              //   Break on end of file
-
-	list = lex (line);                      // Lex line into tokens
-	free (line);
-	if (list == NULL) {
+	sprintf (prompt, "(%d)$ ", nCmd);       // Prompt for command
+	statsLine (nLine);
+	cmd = NULL;
+	prog = NULL;
+	span = 1;
+	first = nLine;
+	if (cached) {                           // Next line from cache
+	    fputs (prompt, stdout);
+	    fflush (stdout);
+	    if (!nextCached (&prog, &line, &span))
+		break;
+	} else if (ahead) {                     // Next line from parse-ahead
+	    fputs (prompt, stdout);
+	    fflush (stdout);
+	    if (!nextParsed (&line, &cmd, &prog, &span))
+		break;
+	} else if ((line = readLine (prompt)) == NULL) {
+	    break;                              // Break on end of file
+	}
+	while (!cached && !ahead && incomplete (line)) {
+	    char *more = readLine ("> ");       // Rest of loop
+	    if (more == NULL)
+		break;
+	    line = joinLine (line, more);
+	    span++;
+	}
+	nLine += span;                          // Source line numbers
+	jobRead ();                             // Time until it starts
+	if (line == NULL && prog == NULL)       // Empty or invalid
 	    continue;
-	} else if (getenv ("DUMP_LIST")) {      // Dump token list only if
-	    dumpList (list);                    //   environment variable set
-	    printf ("\n");
+
+	if (prog == NULL) {                     // Line still to be parsed
+	    text = substitute (strdup (line));  // Expand $(...), keeping
+	    if (construct (text, &cmd)) {       //   line for the cache
+		free (text);                    // (watch, |>, loops)
+	    } else {
+		list = lexSubst (text);         // Lex into tokens
+		free (text);
+		if (list == NULL) {
+		    if (!cached)
+			cacheLine (line, NULL, span);
+		    free (line);
+		    continue;
+		} else if (getenv ("DUMP_LIST")) {  // Dump token list only
+		    dumpList (list);            //   if environment variable
+		    printf ("\n");              //   set
+		}
+
+		cmd = parse (list);             // Parsed command?
+		freeList (list);
+	    }
+	    if (cmd != NULL)
+		prog = compile (cmd);           // Compile command
+	    if (!cached)
+		cacheLine (line, prog, span);
+	    free (line);
+	    if (cmd == NULL)
+		continue;
+	} else if (ahead) {                     // Parsed ahead
+	    cacheLine (line, prog, span);
+	    free (line);
 	}
 
-	cmd = parse (list);                     // Parsed command?
-	freeList (list);
-	if (cmd == NULL) {
-	    continue;
-	} else if (getenv ("DUMP_TREE")) {      // Dump command tree only if
-	    dumpTree (cmd, 0);                  //   environment variable set
+	if (cmd != NULL && getenv ("DUMP_TREE")) {  // Dump command tree only
+	    dumpTree (cmd, 0);                  //   if environment variable
+	    if (getenv ("PARALLEL"))            //   set (and how ; lists
+		dumpParallel (cmd);             //   would run concurrently)
+	    printf ("\n");
+	}
+	if (getenv ("DUMP_CODE")) {             // Dump bytecode only if
+	    dumpProgram (prog);                 //   environment variable set
 	    printf ("\n");
 	}
 
-	process (cmd);                          // Execute command
-	freeCMD (cmd);                          // Free associated storage
+	fflush (stdout);                        // Children inherit buffer
+	profileLine (first, cmd);
+	runProgram (prog);                      // Execute command
+	profileDone ();
+	freeProgram (prog);                     // Free associated storage
+	freeCMD (cmd);
+	jobLine (first);                        // Sample memory use
 	nCmd++;                                 // Adjust prompt
 
     }
 
-    return EXIT_SUCCESS;
+    if (!cached)
+	saveCache ();                           // Keep compiled script
+    reportStats ();
+    reportProfile ();
+    reportPerf ();
+    return (reportJobStats () ? EXIT_SUCCESS : EXIT_FAILURE);
 }
 
 
@@ -127,11 +230,25 @@ void dumpList (struct token *list)
 }
 
 
+// Print word W, showing the loop variables marked in it as ${NAME}
+void dumpWord (char *w)
+{
+    for (bool open = false;  *w;  w++)
+	if (*w == MARK) {
+	    fputs (open ? "}" : "${", stdout);
+	    open = !open;
+	} else
+	    putchar (*w);
+}
+
+
 // Print arguments in command data structure rooted at *C
 void dumpArgs (CMD *c)
 {
-    for (char **q = c->argv;  *q;  q++)
-	fprintf (stdout, ",  argv[%ld] = %s", q-(c->argv), *q);
+    for (char **q = c->argv;  *q;  q++) {
+	fprintf (stdout, ",  argv[%ld] = ", q-(c->argv));
+	dumpWord (*q);
+    }
 }
 
 
@@ -201,6 +318,15 @@ int dumpType (CMD *c, int level)
 	if (c->right != NULL)
 	    fprintf (stdout, "  <simple> HAS RIGHT CHILD");
 
+    } else if (c->type == WATCH) {
+	fprintf (stdout, "level = %d,  argc = %d,  WATCH", level, c->argc);
+	dumpArgs (c);
+	fprintf (stdout, "\nCMD:   ");
+	type = dumpType (c->left, level+1);
+	char sep = (type == SEP_BG) ? '&' : ';';
+	fprintf (stdout, "  %c", sep);
+	type = SEP_END;
+
     } else if (c->argc > 0
 	    || c->argv == NULL
 	    || c->argv[0] != NULL) {
@@ -238,6 +364,40 @@ int dumpType (CMD *c, int level)
 	fprintf (stdout, "  %c", sep);
 	type = SEP_END;
 
+    } else if (c->type == FANOUT) {
+	fprintf (stdout, "level = %d,  argc = %d,  FANOUT", level, c->argc);
+	fprintf (stdout, "\nCMD:   ");
+	type = dumpType (c->left, level+1);
+	fprintf (stdout, "  |>\nCMD: |> ");
+
+	CMD *p;
+	for (p = c->right; p->type == FANOUT; p = p->right) {
+	    type = dumpType (p->left, level+1);
+	    fprintf (stdout, "  |>\nCMD: |> ");
+	}
+	type = dumpType (p, level+1);
+	char sep = (type == SEP_BG) ? '&' : ';';
+	fprintf (stdout, "  %c", sep);
+	type = SEP_END;
+
+    } else if (c->type == FOR) {
+	fprintf (stdout, "level = %d,  argc = %d,  FOR", level, c->argc);
+	dumpArgs (c);
+	fprintf (stdout, "\nCMD: do ");
+	type = dumpType (c->left, level+1);
+	fprintf (stdout, "  ;\nCMD:   done");
+	type = SEP_END;
+
+    } else if (c->type == WHILE || c->type == UNTIL) {
+	fprintf (stdout, "level = %d,  argc = %d,  %s", level, c->argc,
+		 (c->type == WHILE) ? "WHILE" : "UNTIL");
+	fprintf (stdout, "\nCMD:   ");
+	type = dumpType (c->left, level+1);
+	fprintf (stdout, "  ;\nCMD: do ");
+	type = dumpType (c->right, level+1);
+	fprintf (stdout, "  ;\nCMD:   done");
+	type = SEP_END;
+
     } else if (c->type == SEP_AND) {
 	type = dumpType (c->left, level);
 	fprintf (stdout, "  &&\nCMD:   ");
@@ -300,6 +460,18 @@ void dumpTree (CMD *c, int level)
     } else if (c->type == SUBCMD) {
 	fprintf (stdout, "SUBCMD");
 	dumpRedirect (c);
+    } else if (c->type == WATCH) {
+	fprintf (stdout, "WATCH");
+	dumpArgs (c);
+    } else if (c->type == FANOUT) {
+	fprintf (stdout, "FANOUT");
+    } else if (c->type == FOR) {
+	fprintf (stdout, "FOR");
+	dumpArgs (c);
+    } else if (c->type == WHILE) {
+	fprintf (stdout, "WHILE");
+    } else if (c->type == UNTIL) {
+	fprintf (stdout, "UNTIL");
     } else if (c->type == PIPE) {
 	fprintf (stdout, "PIPE");
     } else if (c->type == SEP_AND) {
@@ -0,0 +1,481 @@
+// memo.c                                         Daniel Kim (10/19/26)
+//
+// memo: the built-in command
+//
+//   memo [-e VAR]... [-i FILE]... command [arg]...
+//   memo -s
+//
+// runs a deterministic command at most once for any given input.  The key is
+// a hash of the command's arguments, local variables, working directory, the
+// environment variables VAR, and the contents of its standard input and of
+// each FILE.  A standard input other than a < file (a pipe, or a redirection of
+// an enclosing command) is read to end of file first, hashed, and fed to the
+// command on a miss.  A command that would read the shell's own standard input
+// (which may be a terminal, or what the shell's caller has yet to send) is run
+// without the store, since consuming it is not the command's to do.  On
+// a hit the standard output and exit status saved in the store are replayed
+// without forking; on a miss the command runs and its output is copied both to
+// its destination and into the store.
+//
+// The store is the directory $MEMO_DIR (default ~/.Bash_memo) with one file
+// per key.  Its total size is capped at $MEMO_SIZE bytes (suffix K, M, or G;
+// default 64M) by evicting the least recently used entries.  memo -s prints
+// hit-rate statistics, which are kept in the store across shells.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <dirent.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/sendfile.h>
+#include <linux/limits.h>
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+#define MEMO_MAGIC  "MEMO1"      // Entry header: "MEMO1 <status>\n"
+
+typedef struct {                 // Contents of the stats file
+    uint64_t hits, misses;
+    uint64_t replayed;           // Bytes of output replayed
+} stats;
+
+typedef struct {                 // Two FNV-1a hashes with different bases
+    uint64_t a, b;
+} key;
+
+static struct stat shellIn;      // The shell's standard input
+static bool shellInKnown = false;
+
+
+
+// Add the N bytes at P to key K
+static void hash (key *k, const void *p, size_t n)
+{
+    const unsigned char *s = p;
+    for (size_t i = 0; i < n; i++) {
+        k->a = (k->a ^ s[i]) * 1099511628211ULL;
+        k->b = (k->b ^ s[i]) * 1099511628211ULL;
+    }
+}
+
+
+// Add string S (or a marker if S is NULL) to key K
+static void hash_str (key *k, const char *s)
+{
+    if (s)
+        hash(k, s, strlen(s) + 1);
+    else
+        hash(k, "\377", 1);
+}
+
+
+// Add the contents of file PATH to key K; return false if it cannot be read
+static bool hash_file (key *k, const char *path)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        perror(path);
+        if (fd != -1)
+            close(fd);
+        return false;
+    }
+    hash_str(k, path);
+    hash(k, &st.st_size, sizeof(st.st_size));
+    if (st.st_size > 0) {
+        void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            perror(path);
+            close(fd);
+            return false;
+        }
+        hash(k, p, st.st_size);
+        munmap(p, st.st_size);
+    }
+    close(fd);
+    return true;
+}
+
+
+// Add everything left on the standard input to key K, keeping a copy; return
+// a descriptor from which the copy can be read, or -1 on error
+static int hash_stdin (key *k)
+{
+    char buf[65536];
+    ssize_t n;
+    int fd = memfd_create("memo-stdin", MFD_CLOEXEC);
+
+    if (fd == -1) {
+        perror("memo: memfd_create failed");
+        return -1;
+    }
+    hash_str(k, "<stdin>");
+    while ((n = read(0, buf, sizeof(buf))) > 0 || (n == -1 && errno == EINTR))
+        if (n > 0) {
+            hash(k, buf, n);
+            if (write(fd, buf, n) != n) {
+                perror("memo: stdin");
+                close(fd);
+                return -1;
+            }
+        }
+    lseek(fd, 0, SEEK_SET);
+    return fd;
+}
+
+
+// Note the shell's standard input, so that memo can tell it from a pipe
+void startMemo (void)
+{
+    shellInKnown = (fstat(0, &shellIn) == 0);
+}
+
+
+// Is the standard input a terminal or the shell's own?
+static bool inherited (void)
+{
+    struct stat st;
+    if (isatty(0) || fstat(0, &st) == -1)
+        return true;
+    return shellInKnown && st.st_dev == shellIn.st_dev && st.st_ino == shellIn.st_ino;
+}
+
+
+// Return the store directory (created if need be), or NULL
+static const char *store (void)
+{
+    static char dir[PATH_MAX];
+    char *env = getenv("MEMO_DIR");
+
+    if (env)
+        snprintf(dir, sizeof(dir), "%s", env);
+    else if (getenv("HOME"))
+        snprintf(dir, sizeof(dir), "%s/.Bash_memo", getenv("HOME"));
+    else
+        return NULL;
+
+    if (mkdir(dir, 0700) == -1 && errno != EEXIST) {
+        perror(dir);
+        return NULL;
+    }
+    return dir;
+}
+
+
+// Return the cap on the size of the store in bytes
+static off_t store_cap (void)
+{
+    char *env = getenv("MEMO_SIZE"), *end;
+    if (env == NULL)
+        return 64L << 20;
+
+    off_t cap = strtoll(env, &end, 10);
+    switch (*end) {
+    case 'k': case 'K':  cap <<= 10;  break;
+    case 'm': case 'M':  cap <<= 20;  break;
+    case 'g': case 'G':  cap <<= 30;  break;
+    }
+    return cap;
+}
+
+
+// Add HITS, MISSES, and REPLAYED to the statistics kept in DIR and return
+// the totals
+static stats update_stats (const char *dir, int hits, int misses, off_t replayed)
+{
+    char path[PATH_MAX];
+    stats s = { 0, 0, 0 };
+
+    snprintf(path, sizeof(path), "%s/stats", dir);
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd == -1)
+        return s;
+
+    flock(fd, LOCK_EX);
+    if (pread(fd, &s, sizeof(s), 0) != sizeof(s))
+        s = (stats) { 0, 0, 0 };
+    s.hits += hits;
+    s.misses += misses;
+    s.replayed += replayed;
+    if ((hits || misses) && pwrite(fd, &s, sizeof(s), 0) != sizeof(s))
+        perror(path);
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    return s;
+}
+
+
+// Evict least recently used entries of store DIR until it fits in its cap
+static void evict (const char *dir)
+{
+    typedef struct { char name[40]; off_t size; struct timespec used; } ent;
+    ent *e = NULL;
+    size_t n = 0;
+    off_t total = 0, cap = store_cap();
+    struct dirent *d;
+    struct stat st;
+
+    DIR *dp = opendir(dir);
+    if (dp == NULL)
+        return;
+    while ((d = readdir(dp)) != NULL) {
+        if (strlen(d->d_name) != 32 || fstatat(dirfd(dp), d->d_name, &st, 0) == -1)
+            continue;                                   // Not an entry
+        e = realloc(e, (n + 1) * sizeof(ent));
+        strcpy(e[n].name, d->d_name);
+        e[n].size = st.st_size;
+        e[n].used = st.st_mtim;
+        total += st.st_size;
+        n++;
+    }
+
+    while (total > cap && n > 0) {                      // Remove oldest
+        size_t old = 0;
+        for (size_t i = 1; i < n; i++)
+            if (e[i].used.tv_sec < e[old].used.tv_sec
+                  || (e[i].used.tv_sec == e[old].used.tv_sec
+                      && e[i].used.tv_nsec < e[old].used.tv_nsec))
+                old = i;
+        unlinkat(dirfd(dp), e[old].name, 0);
+        total -= e[old].size;
+        e[old] = e[--n];
+    }
+    closedir(dp);
+    free(e);
+}
+
+
+// Open the destination of the standard output of PCMD; return -1 on error
+static int open_output (CMD *pcmd)
+{
+    if (pcmd->toType == NONE)
+        return dup(1);
+
+    int obits = O_CREAT | O_WRONLY | O_CLOEXEC;
+    obits |= (pcmd->toType == RED_APP ? O_APPEND : O_TRUNC);
+    int fd = open(pcmd->toFile, obits, 0644);
+    if (fd == -1)
+        perror(pcmd->toFile);
+    return fd;
+}
+
+
+// Replay entry PATH to the destination of PCMD; return the saved status, or
+// -1 if the entry is missing or unreadable
+static int replay (const char *path, CMD *pcmd, off_t *bytes)
+{
+    char head[32];
+    int status;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+    ssize_t n = pread(fd, head, sizeof(head) - 1, 0);
+    head[(n > 0 ? n : 0)] = '\0';
+    char *nl = strchr(head, '\n');
+    if (nl == NULL || sscanf(head, MEMO_MAGIC " %d", &status) != 1) {
+        close(fd);
+        return -1;
+    }
+
+    int out = open_output(pcmd);
+    if (out == -1) {
+        close(fd);
+        return errno;
+    }
+
+    off_t off = nl - head + 1;
+    struct stat st;
+    fstat(fd, &st);
+    *bytes = st.st_size - off;
+    while (off < st.st_size) {                          // Copy in the kernel
+        ssize_t sent = sendfile(out, fd, &off, st.st_size - off);
+        if (sent <= 0) {                                // Fall back on
+            char buf[65536];                            //   read and write
+            while ((n = pread(fd, buf, sizeof(buf), off)) > 0
+                     && write(out, buf, n) == n)
+                off += n;
+            break;
+        }
+    }
+    close(out);
+    close(fd);
+
+    utimensat(AT_FDCWD, path, NULL, 0);                 // Most recent use
+    return status;
+}
+
+
+// Run INNER (a copy of PCMD without the memo prefix or output redirection)
+// with RUN and standard input IN (if not -1), copying its standard output to
+// the destination of PCMD and to entry PATH; return its status
+static int record (const char *path, CMD *pcmd, CMD *inner, int in, int (*run) (CMD *))
+{
+    int fd[2], status;
+    pid_t pid;
+
+    int out = open_output(pcmd);
+    if (out == -1)
+        return errno;
+    if (pipe(fd) == -1) {
+        perror("memo: pipe failed");
+        close(out);
+        return errno;
+    }
+
+    fflush(stdout);
+    if ((pid = perfFork(inner)) < 0) {
+        perror("memo: fork failed");
+        close(fd[0]);
+        close(fd[1]);
+        close(out);
+        return errno;
+    }
+    else if (pid == 0) {                                // child
+        close(fd[0]);
+        close(out);
+        if (in >= 0)
+            dup2(in, 0);
+        dup2(fd[1], 1);
+        close(fd[1]);
+        _exit(run(inner));
+    }
+
+    // parent: tee output into the entry
+    close(fd[1]);
+    char *tmp;
+    if (asprintf(&tmp, "%s.%d", path, getpid()) == -1)
+        tmp = NULL;
+    FILE *save = (tmp ? fopen(tmp, "w") : NULL);
+    if (save)
+        fprintf(save, "%-20s\n", "");                   // Room for the header
+
+    signal(SIGINT,SIG_IGN);
+    char buf[65536];
+    ssize_t n;
+    while ((n = read(fd[0], buf, sizeof(buf))) > 0 || (n == -1 && errno == EINTR)) {
+        if (n > 0 && write(out, buf, n) != n)
+            ;                                           // Reader went away
+        if (n > 0 && save)
+            fwrite(buf, 1, n, save);
+    }
+    close(fd[0]);
+    close(out);
+    waitpid(pid, &status, 0);
+    perfReap(pid);
+    signal(SIGINT,SIG_DFL);
+    status = (WIFEXITED(status) ? WEXITSTATUS(status) : 128+WTERMSIG(status));
+
+    if (save) {                                         // Keep unless killed
+        char head[22];
+        snprintf(head, sizeof(head), MEMO_MAGIC " %-14d", status);
+        rewind(save);
+        fputs(head, save);
+        if (fclose(save) == 0 && status < 128 && rename(tmp, path) == 0)
+            tmp[0] = '\0';
+        if (tmp[0])
+            unlink(tmp);
+    }
+    free(tmp);
+    return status;
+}
+
+
+// Execute memo command PCMD, running the command it names with RUN on a
+// miss; return its status
+int memo (CMD *pcmd, int (*run) (CMD *))
+{
+    key k = { 14695981039346656037ULL, 0x84222325cbf29ce4ULL };
+    const char *dir = store();
+    int i;
+
+    if (dir == NULL)
+        return 1;
+
+    if (pcmd->argc == 2 && strcmp(pcmd->argv[1], "-s") == 0) {
+        stats s = update_stats(dir, 0, 0, 0);
+        uint64_t total = s.hits + s.misses;
+        int out = open_output(pcmd);
+        if (out == -1)
+            return errno;
+        fflush(stdout);
+        dprintf(out, "memo: %llu hits, %llu misses (%.1f%% hit rate), %llu bytes replayed\n",
+                (unsigned long long) s.hits, (unsigned long long) s.misses,
+                (total ? 100.0 * s.hits / total : 0.0),
+                (unsigned long long) s.replayed);
+        close(out);
+        return 0;
+    }
+
+    for (i = 1; i + 1 < pcmd->argc; i += 2) {           // Options
+        if (strcmp(pcmd->argv[i], "-e") == 0) {
+            hash_str(&k, pcmd->argv[i+1]);
+            hash_str(&k, getenv(pcmd->argv[i+1]));
+        } else if (strcmp(pcmd->argv[i], "-i") == 0) {
+            if (!hash_file(&k, pcmd->argv[i+1]))
+                return 1;
+        } else {
+            break;
+        }
+    }
+    if (i >= pcmd->argc || pcmd->argv[i][0] == '-') {
+        fprintf(stderr, "usage: memo [-e VAR]... [-i FILE]... command [arg]...  OR  memo -s\n");
+        return 1;
+    }
+
+    CMD inner = *pcmd;                                  // The command itself
+    inner.argv += i;
+    inner.argc -= i;
+    if (pcmd->fromType == NONE && inherited())          // Input not ours
+        return run(&inner);
+    inner.toType = NONE;
+    inner.toFile = NULL;
+
+    for (int j = 0; j < inner.argc; j++)
+        hash_str(&k, inner.argv[j]);
+    hash_str(&k, "");
+    for (int j = 0; j < pcmd->nLocal; j++) {
+        hash_str(&k, pcmd->locVar[j]);
+        hash_str(&k, pcmd->locVal[j]);
+    }
+    char *cwd = getcwd(NULL, 0);
+    hash_str(&k, cwd);
+    free(cwd);
+    int in = -1;
+    if (pcmd->fromType == RED_IN && !hash_file(&k, pcmd->fromFile))
+        return 1;
+    if (pcmd->fromType == NONE && (in = hash_stdin(&k)) == -1)
+        return 1;
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%016llx%016llx", dir,
+             (unsigned long long) k.a, (unsigned long long) k.b);
+
+    off_t bytes = 0;
+    int status = replay(path, pcmd, &bytes);
+    if (status >= 0) {
+        update_stats(dir, 1, 0, bytes);
+        if (in >= 0)
+            close(in);
+        return status;
+    }
+
+    status = record(path, pcmd, &inner, in, run);
+    if (in >= 0)
+        close(in);
+    update_stats(dir, 0, 1, 0);
+    evict(dir);
+    return status;
+}
@@ -0,0 +1,183 @@
+// meter.c                                        Daniel Kim (10/19/26)
+//
+// Throughput meter for pipelines.
+//
+// If $PIPE_METER is set, each pipe between two stages of a pipeline gets a
+// relay process that moves the data from the pipe the left stage writes to
+// a second pipe that the right stage reads, using splice() so the data is
+// never copied to user space.  The relay counts the bytes and the time it
+// spends waiting for input (the left stage is the slower) and for room in
+// the full output pipe (the right stage is the slower), and prints
+//
+//   meter seq | sort: 588895 B in 0.121 s (4.87 MB/s); waited 0.094 s for
+//   input, 0.002 s for output
+//
+// on stderr when the left stage closes the pipe.  Relays are named "meter",
+// so pkill -USR1 meter makes all of them report while they run.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/prctl.h>
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+#define CHUNK  (64 * 1024)       // Most bytes moved by one splice()
+
+typedef struct {
+    char name[64];               // "left | right"
+    uint64_t bytes;
+    double start;                // Time relay started
+    double waitIn, waitOut;      // Time spent waiting for each side
+} edge;
+
+static volatile sig_atomic_t asked = 0;  // Report requested by SIGUSR1
+
+
+
+// Return the current time in seconds
+static double now (void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+
+// Handle SIGUSR1 by asking for a report
+static void ask (int sig)
+{
+    asked = 1;
+}
+
+
+// Return the name of the first command in stage C of a pipeline
+static const char *stage_name (CMD *c)
+{
+    while (c->type == PIPE)
+        c = c->left;
+    return (c->type == SIMPLE ? c->argv[0] : "(...)");
+}
+
+
+// Print the statistics for edge E on stderr; LIVE if it is still running
+static void report (edge *e, bool live)
+{
+    double t = now() - e->start;
+    fprintf(stderr, "meter %s%s: %llu B in %.3f s (%.2f MB/s); waited %.3f s"
+            " for input, %.3f s for output\n", e->name, (live ? " (running)" : ""),
+            (unsigned long long) e->bytes, t, (t > 0 ? e->bytes / t / 1e6 : 0),
+            e->waitIn, e->waitOut);
+}
+
+
+// Wait until FD is ready for EVENTS, adding the time taken to *WAITED
+static void await (int fd, short events, double *waited)
+{
+    struct pollfd p = { fd, events, 0 };
+    double t = now();
+    poll(&p, 1, -1);
+    *waited += now() - t;
+}
+
+
+// Move data from IN to OUT until IN reaches end of file or OUT is closed
+static void relay (int in, int out, edge *e)
+{
+    char buf[CHUNK];
+    bool useSplice = true;
+
+    fcntl(in, F_SETFL, fcntl(in, F_GETFL) | O_NONBLOCK);
+    fcntl(out, F_SETFL, fcntl(out, F_GETFL) | O_NONBLOCK);
+    e->start = now();
+
+    for ( ; ; ) {
+        if (asked) {
+            asked = 0;
+            report(e, true);
+        }
+
+        ssize_t n = (useSplice ? splice(in, NULL, out, NULL, CHUNK,
+                                        SPLICE_F_MOVE | SPLICE_F_NONBLOCK)
+                               : read(in, buf, sizeof(buf)));
+        if (n == 0)
+            return;
+        if (n > 0 && !useSplice) {                      // Copy what was read
+            for (ssize_t done = 0, w; done < n; done += (w > 0 ? w : 0)) {
+                if ((w = write(out, buf + done, n - done)) == -1 && errno == EAGAIN)
+                    await(out, POLLOUT, &e->waitOut);
+                else if (w == -1 && errno != EINTR)
+                    return;
+            }
+        }
+        if (n > 0) {
+            e->bytes += n;
+            continue;
+        }
+
+        if (errno == EINVAL && useSplice)
+            useSplice = false;
+        else if (errno == EAGAIN) {                     // Which side is slow?
+            struct pollfd p = { in, POLLIN, 0 };
+            if (poll(&p, 1, 0) == 0)
+                await(in, POLLIN, &e->waitIn);
+            else
+                await(out, POLLOUT, &e->waitOut);
+        }
+        else if (errno != EINTR)                        // (EPIPE: reader gone)
+            return;
+    }
+}
+
+
+// Called when a pipeline stage for PIPE command PCMD has created pipe FD: if
+// metering, start a relay between FD[0] and a new pipe, which replaces FD[0];
+// return the relay's pid, or 0 if there is none
+pid_t meterPipe (int fd[2], CMD *pcmd)
+{
+    int m[2];
+    pid_t pid;
+
+    if (getenv("PIPE_METER") == NULL)
+        return 0;
+    if (pipe(m) == -1) {
+        perror("PIPE_METER: pipe failed");
+        return 0;
+    }
+
+    if ((pid = fork()) < 0) {
+        perror("PIPE_METER: fork failed");
+        close(m[0]);
+        close(m[1]);
+        return 0;
+    }
+
+    else if (pid == 0) {     // relay
+        edge e = { "", 0, 0, 0, 0 };
+        snprintf(e.name, sizeof(e.name), "%s | %s",
+                 stage_name(pcmd->left), stage_name(pcmd->right));
+        signal(SIGINT, SIG_IGN);
+        signal(SIGPIPE, SIG_IGN);
+        signal(SIGUSR1, ask);
+        prctl(PR_SET_NAME, "meter");                    // (pkill finds it now)
+        close(fd[1]);
+        close(m[0]);
+        relay(fd[0], m[1], &e);
+        report(&e, false);
+        _exit(0);
+    }
+
+    close(fd[0]);
+    close(m[1]);
+    fd[0] = m[0];
+    return pid;
+}
@@ -0,0 +1,268 @@
+// perf.c                                         Daniel Kim (10/19/26)
+//
+// Performance counters for jobs.
+//
+// If $PERF is set, each job that the shell starts (a foreground command,
+// pipeline, subshell, or fan-out, a backgrounded list, a command run by
+// PARALLEL, memo, or xargs, or a $(...) list) is counted with
+// perf_event_open(): CPU cycles, instructions, cache misses, and branch
+// misses, or, if the hardware counters cannot be used (no PMU, as in most
+// virtual machines, or perf_event_paranoid forbids them), the software
+// counters task-clock, context switches, page faults, and CPU migrations.  The counters are opened on the child with inherit set,
+// so they also count the processes it creates (the stages of a pipeline),
+// and the child waits on a pipe until they are open, so that nothing it does
+// escapes them.  When the shell reaps the job the counts are printed on
+// stderr after its Completed line (or after it finishes, in the foreground),
+//
+//   perf 4242 sort: 81234567 cycles, 91234567 instructions (1.12 IPC),
+//        123456 cache-misses, 23456 branch-misses
+//
+// and at exit the totals and the commands that used the most are printed.
+// Counts are of user-space events only when perf_event_paranoid requires it,
+// and are scaled when the kernel had to multiplex the counters.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+#define NEVENTS  4               // Counters per job
+#define TOP      10              // Commands in summary
+
+typedef struct {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+} event;
+
+static const event hardware[NEVENTS] = {
+    { "cycles",           PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "cache-misses",     PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "branch-misses",    PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES } };
+
+static const event software[NEVENTS] = {
+    { "ns task-clock",    PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    { "context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+    { "page-faults",      PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    { "cpu-migrations",   PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS } };
+
+typedef struct {                 // A job being counted
+    pid_t pid;
+    char name[32];               // Its first command
+    int fd[NEVENTS];             // Its counters (-1 if unavailable)
+} job;
+
+typedef struct {                 // Totals for a command name
+    char name[32];
+    int jobs;
+    uint64_t count[NEVENTS];
+} usage;
+
+static const event *events = NULL;   // hardware[] or software[]; NULL if off
+static bool userOnly = false;        // Count user-space events only?
+static bool counted = false;         // This process is part of a counted job?
+
+static job *jobs = NULL;             // Jobs not yet reaped
+static int nJobs = 0;
+static usage *usages = NULL;         // Totals by command
+static int nUsages = 0;
+static usage total;
+
+
+
+// Open counter E on process PID (0 = this one); return its descriptor or -1
+static int open_counter (const event *e, pid_t pid)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = e->type;
+    attr.config = e->config;
+    attr.inherit = 1;
+    attr.exclude_kernel = userOnly;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+
+// Start counting if $PERF is set, choosing hardware or software counters
+void startPerf (void)
+{
+    const event *sets[] = { hardware, software };
+
+    if (getenv("PERF") == NULL)
+        return;
+    for (int i = 0; i < 2 && events == NULL; i++)
+        for (int j = 0; j < 2 && events == NULL; j++) {
+            userOnly = j;
+            int fd = open_counter(&sets[i][0], 0);
+            if (fd >= 0) {
+                events = sets[i];
+                close(fd);
+            }
+        }
+    if (events == NULL)
+        perror("PERF: perf_event_open failed");
+    else if (events == software)
+        fprintf(stderr, "PERF: hardware counters unavailable; using software counters\n");
+}
+
+
+// Return the name of the first command in C
+static const char *first_name (CMD *c)
+{
+    while (c && (c->type == PIPE || c->type == FANOUT || c->type == SEP_END
+                 || c->type == SEP_BG || c->type == SEP_AND || c->type == SEP_OR))
+        c = c->left;
+    return (c == NULL ? "(job)" : c->type == SIMPLE ? c->argv[0] : "(...)");
+}
+
+
+// Fork a child to run command PCMD (NULL if unknown), with counters on it if
+// counting and this process is not already part of a counted job; return
+// as fork() does
+pid_t perfFork (CMD *pcmd)
+{
+    int sync[2];
+
+    if (events == NULL || counted || pipe2(sync, O_CLOEXEC) == -1)
+        return fork();
+
+    pid_t pid = fork();
+    if (pid == 0) {                                     // Wait for counters
+        char c;
+        close(sync[1]);
+        while (read(sync[0], &c, 1) == -1 && errno == EINTR)
+            ;
+        close(sync[0]);
+        counted = true;
+        nJobs = 0;
+        return 0;
+    }
+
+    if (pid > 0) {
+        jobs = realloc(jobs, (nJobs + 1) * sizeof(job));
+        job *j = &jobs[nJobs++];
+        j->pid = pid;
+        snprintf(j->name, sizeof(j->name), "%s", first_name(pcmd));
+        for (int i = 0; i < NEVENTS; i++)
+            j->fd[i] = open_counter(&events[i], pid);
+    }
+    close(sync[0]);                                     // Child may go on
+    close(sync[1]);
+    return pid;
+}
+
+
+// Return the value of counter FD, scaled if it was multiplexed
+static uint64_t read_counter (int fd)
+{
+    uint64_t v[3];                                      // Value, enabled,
+
+    if (fd < 0 || read(fd, v, sizeof(v)) != sizeof(v))  //   running
+        return 0;
+    if (v[2] > 0 && v[2] < v[1])
+        return (uint64_t) ((double) v[0] * v[1] / v[2]);
+    return v[0];
+}
+
+
+// Add COUNT to the totals U for command NAME
+static void add_usage (usage *u, const char *name, uint64_t *count)
+{
+    snprintf(u->name, sizeof(u->name), "%s", name);
+    u->jobs++;
+    for (int i = 0; i < NEVENTS; i++)
+        u->count[i] += count[i];
+}
+
+
+// Print COUNT (of events that were counted if HAVE[i]) on stderr
+static void print_counts (uint64_t *count, bool *have)
+{
+    for (int i = 0, n = 0; i < NEVENTS; i++)
+        if (have[i]) {
+            fprintf(stderr, "%s%llu %s", (n++ ? ", " : ""),
+                    (unsigned long long) count[i], events[i].name);
+            if (events == hardware && i == 1 && have[0] && count[0] > 0)
+                fprintf(stderr, " (%.2f IPC)", (double) count[1] / count[0]);
+        }
+    fprintf(stderr, "\n");
+}
+
+
+// Called when child PID has been reaped: if it was counted, print and total
+// its counts
+void perfReap (pid_t pid)
+{
+    int k;
+
+    for (k = 0; k < nJobs && jobs[k].pid != pid; k++)
+        ;
+    if (k == nJobs)
+        return;
+
+    job *j = &jobs[k];
+    uint64_t count[NEVENTS];
+    bool have[NEVENTS];
+    for (int i = 0; i < NEVENTS; i++) {
+        have[i] = (j->fd[i] >= 0);
+        count[i] = read_counter(j->fd[i]);
+        if (have[i])
+            close(j->fd[i]);
+    }
+    fprintf(stderr, "perf %d %s: ", pid, j->name);
+    print_counts(count, have);
+
+    int u;
+    for (u = 0; u < nUsages && strcmp(usages[u].name, j->name) != 0; u++)
+        ;
+    if (u == nUsages) {
+        usages = realloc(usages, (nUsages + 1) * sizeof(usage));
+        memset(&usages[nUsages++], 0, sizeof(usage));
+    }
+    add_usage(&usages[u], j->name, count);
+    add_usage(&total, "total", count);
+
+    jobs[k] = jobs[--nJobs];
+}
+
+
+// Compare command totals by first counter (most first) for qsort()
+static int by_count (const void *a, const void *b)
+{
+    uint64_t x = ((const usage *) a)->count[0], y = ((const usage *) b)->count[0];
+    return (x < y) - (x > y);
+}
+
+
+// Print the totals for the session and for the commands that used the most
+// on stderr
+void reportPerf (void)
+{
+    bool have[NEVENTS] = { true, true, true, true };
+
+    if (events == NULL || counted || total.jobs == 0)
+        return;
+    fprintf(stderr, "\nperf: %d jobs: ", total.jobs);
+    print_counts(total.count, have);
+
+    qsort(usages, nUsages, sizeof(usage), by_count);
+    for (int u = 0; u < nUsages && u < TOP; u++) {
+        fprintf(stderr, "  %-16s %5d  ", usages[u].name, usages[u].jobs);
+        print_counts(usages[u].count, have);
+    }
+}
@@ -15,10 +15,14 @@
 #include <sys/wait.h>
 #include <linux/limits.h>
 #include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
 
 // Print error message and die with STATUS
 #define error_Exit(msg, status)  perror(msg), _exit(status)
 
+// Names of built-in commands
+const char *builtins[] = { "cd", "dirs", "memo", "timeout", "wait", "xargs", NULL };
+
 
 
 // Set $? to "STATUS" and return STATUS
@@ -36,11 +40,36 @@ static int set_status (int status)
 static void reap_zombies() {//int sig) {
     int status;
     pid_t pid;
+    double start = jobTime();
     while ((pid = waitpid((pid_t)(-1), &status, WNOHANG)) > 0) {
 
         status = (WIFEXITED(status) ? WEXITSTATUS(status) : 128+WTERMSIG(status));
         fprintf(stderr, "Completed: %d (%d)\n",pid, status);
+        perfReap(pid);
+        jobReaped(pid);
+    }
+    jobReapCall(start);
+}
+
+
+
+// Execute dirs command PCMD, printing the current directory on OUT; return
+// its status
+int dirs (CMD *pcmd, FILE *out)
+{
+    if (pcmd->argc > 1) {
+        fprintf(stderr, "usage: dirs\n");
+        return 1;
+    }
+
+    char *cwd = getcwd(NULL,0);
+    if (cwd == NULL) {
+        perror("dirs: getcwd failed");
+        return errno;
     }
+    fprintf(out, "%s\n", cwd);
+    free(cwd);
+    return 0;
 }
 
 
@@ -87,11 +116,24 @@ static void vars_redir(CMD *pcmd)
 
 
 
-// Execute command list CMDLIST and return status of last command executed
-// Return status of process
-// SKIP is true if instructed to skip current cmd (left subtree if not SIMPLE),
-// whose status is SKIP_STATUS
-static int execute (CMD *cmdList, int skip, int skip_status)
+// Is NAME a built-in command?
+bool isBuiltin (const char *name)
+{
+    for (const char **p = builtins; *p; p++)
+        if (strcmp(name, *p) == 0)
+            return true;
+    return false;
+}
+
+
+
+static int interpret (CMD *cmdList);
+static int execute (CMD *cmdList);
+
+
+// Execute command CMDLIST (SIMPLE, PIPE, or SUBCMD) and return its status;
+// command lists are compiled and run by runProgram()
+static int execute_node (CMD *cmdList)
 {
     CMD *pcmd = cmdList;
     pid_t pid;     // fork()
@@ -154,6 +196,7 @@ static int execute (CMD *cmdList, int skip, int skip_status)
 
             else {
                 errno = 0;
+                double start = jobTime();
 
                 // Ignore SIGINT while waiting
                 signal(SIGINT,SIG_IGN);
@@ -165,10 +208,13 @@ static int execute (CMD *cmdList, int skip, int skip_status)
                     else  {
                         status = (WIFEXITED(status) ? WEXITSTATUS(status) : 128+WTERMSIG(status));
                         fprintf(stderr, "Completed: %d (%d)\n",pid, status);
+                        perfReap(pid);
+                        jobReaped(pid);
                     }
                     
                 }
                 signal(SIGINT,SIG_DFL);
+                jobWaited(start);
                 return set_status(0);
             }
         }
@@ -176,15 +222,32 @@ static int execute (CMD *cmdList, int skip, int skip_status)
 
 
 
+        // memo
+        else if (strcmp(*(pcmd->argv),"memo") == 0) {
+            return set_status(memo(pcmd, execute));
+        }
+
+        // timeout
+        else if (strcmp(*(pcmd->argv),"timeout") == 0) {
+            return set_status(timeout(pcmd, execute));
+        }
+
+        // xargs
+        else if (strcmp(*(pcmd->argv),"xargs") == 0) {
+            return set_status(xargs(pcmd));
+        }
+
+
+
         // Other commands (dirs, external)
         else {
-            if ((pid = fork()) < 0) {
+            if ((pid = perfFork(pcmd)) < 0) {
                 perror("SIMPLE: fork failed");
                 return set_status(errno);
             }
 
             else if (pid == 0) {     // child
-                
+                startChild();
 
                 // local variables and redirection
                 vars_redir(pcmd);
@@ -192,25 +255,9 @@ static int execute (CMD *cmdList, int skip, int skip_status)
 
                 // Built-in command? (dirs)
                 if (strcmp(*(pcmd->argv),"dirs") == 0) {
-                    
-                    if (pcmd->argc > 1) {
-                        fprintf(stderr, "usage: dirs\n");
-                        _exit(set_status(1));
-                    }
-
-                    else {
-                        char *cwd = getcwd(NULL,0);
-                        if (cwd == NULL) {
-                            perror("dirs: getcwd failed");
-                            _exit(set_status(errno));
-                        }
-                        else {
-                            printf("%s\n",cwd);
-                            fflush(stdout);
-                            _exit(set_status(0));
-
-                        }
-                    }
+                    status = dirs(pcmd, stdout);
+                    fflush(stdout);
+                    _exit(set_status(status));
                 }
 
 
@@ -222,8 +269,8 @@ static int execute (CMD *cmdList, int skip, int skip_status)
                 
                 // wait and ignore SIGINT
                 signal(SIGINT,SIG_IGN);
-                waitpid(pid, &status, 0); 
-
+                waitChild(pid, &status); 
+                perfReap(pid);
 
                 signal(SIGINT,SIG_DFL);
 
@@ -241,7 +288,7 @@ static int execute (CMD *cmdList, int skip, int skip_status)
     else if (pcmd->type == PIPE) {
         
 
-        if ((pid = fork()) < 0) {
+        if ((pid = perfFork(pcmd)) < 0) {
             perror("PIPE: fork failed");
             return set_status(errno);
         }
@@ -251,11 +298,14 @@ static int execute (CMD *cmdList, int skip, int skip_status)
         // spawn grandchild to recursve right subtree
 
         else if (pid == 0) {          
-            
+            startChild();
 
             // Pipe buffer
             if (pipe(fd) == -1)
                 error_Exit("PIPE: pipe failed",errno); 
+
+            // Relay to meter the pipe if $PIPE_METER is set
+            pid_t relay = meterPipe(fd, pcmd);
             
             
             if ((pid = fork()) < 0) {
@@ -277,7 +327,7 @@ static int execute (CMD *cmdList, int skip, int skip_status)
                 close(fd[1]);
                 
                 // drag status from end of pipeline
-                int right_status = execute(pcmd->right,0,0);
+                int right_status = execute(pcmd->right);
 
                 // Close pipe
                 close(0);
@@ -301,7 +351,7 @@ static int execute (CMD *cmdList, int skip, int skip_status)
                 close(fd[0]);
                 
                 // execute left subtree
-                int left_status = execute(pcmd->left,0,0);
+                int left_status = execute(pcmd->left);
                 
 
                 // Close pipe
@@ -311,6 +361,8 @@ static int execute (CMD *cmdList, int skip, int skip_status)
                 // Wait for rest of pipe
                 waitpid(pid, &status, 0);
                 status = (WIFEXITED(status) ? WEXITSTATUS(status) : 128+WTERMSIG(status));
+                if (relay > 0)
+                    waitpid(relay, NULL, 0);
 
 
                 // set STATUS to rightmost failure, or 0
@@ -330,7 +382,8 @@ static int execute (CMD *cmdList, int skip, int skip_status)
         else {                        
 
             signal(SIGINT,SIG_IGN);
-            waitpid(pid, &status, 0); 
+            waitChild(pid, &status); 
+            perfReap(pid);
 
             signal(SIGINT,SIG_DFL);
 
@@ -344,24 +397,26 @@ static int execute (CMD *cmdList, int skip, int skip_status)
     // Subcommands
     else if (pcmd->type == SUBCMD) {
 
-        if ((pid = fork()) < 0) {
+        if ((pid = perfFork(pcmd)) < 0) {
             perror("SUBCMD: fork failed");
             return set_status(errno);
         }
 
         else if (pid == 0) { // child executes left subtree
-            
+            startChild();
+
             // local variables and redirection
             vars_redir(pcmd);
 
 
-            _exit(execute(pcmd->left,0,0)); 
+            _exit(interpret(pcmd->left)); 
         }
 
         else { // parent waits for child to terminate
 
             signal(SIGINT,SIG_IGN);
-            waitpid(pid, &status, 0); 
+            waitChild(pid, &status); 
+            perfReap(pid);
             
             signal(SIGINT,SIG_DFL);
 
@@ -374,85 +429,242 @@ static int execute (CMD *cmdList, int skip, int skip_status)
    
 
 
-    // &&, ||
-    // Return status of last command
-    else if (pcmd->type == SEP_AND || pcmd->type == SEP_OR) {
-        
-        int left_status = (skip ? skip_status : execute(pcmd->left,0,0));
-        int skip_next; // skip next command?
-
-        if (pcmd->type == SEP_AND)
-            skip_next = (left_status != 0 ? 1 : 0);
-        else if (pcmd->type == SEP_OR)
-            skip_next = (left_status == 0 ? 1 : 0);
+    // watch PATH... -- list
+    else if (pcmd->type == WATCH) {
+        return set_status(watch(pcmd, interpret));
+    }
 
 
 
-        if (skip_next) { 
+    // producer |> branch |> ...
+    else if (pcmd->type == FANOUT) {
+        return set_status(fanout(pcmd, execute));
+    }
 
-            // === SKIP === 
-            // If right subtree is SIMPLE or PIPE or SUBCMD, done
-            // Otherwise, execute right subtree with SKIP==TRUE 
 
-            CMD *right_child = pcmd->right;
-            if (right_child->type == SIMPLE ||
-                right_child->type == PIPE   ||
-                right_child->type == SUBCMD) {
 
-                return left_status; // last cmd = skipped cmd
-            }
+    // for, while, until
+    else if (pcmd->type == FOR || pcmd->type == WHILE || pcmd->type == UNTIL) {
+        return set_status(loop(pcmd));
+    }
 
-            else
-                return execute(right_child,1,left_status);
-        }
 
 
-        else 
-            return execute(pcmd->right,0,0);
+    // ;, &, &&, ||
+    else if (pcmd->type != NONE) {
+        return interpret(pcmd);
     }
 
-    // ;
-    // Return status of command following ; if exists, or left cmd otherwise
-    else if (pcmd->type == SEP_END) {
+    else
+        return EXIT_SUCCESS;
+}
+
+// Execute command CMDLIST as above after substituting loop variables and
+// pathname expansion, charging the system calls made for it to its type when
+// they are being counted and timing it when profiling
+static int execute (CMD *cmdList)
+{
+    CMD bound;     // Node with loop variables' values in its words and
+    CMD expanded;  //   redirections (the tree itself may be rerun), and
+                   //   SIMPLE after globbing
+    bool isBound = bindCMD(cmdList, &bound);
+    CMD *pcmd = (isBound ? &bound : cmdList);
+    int globbed = (cmdList->type == SIMPLE ? globCMD(pcmd, &expanded) : 0);
+    if (globbed > 0)
+        pcmd = &expanded;
+
+    int status = 1;
+    if (globbed >= 0) {
+        int outer = statsNode(cmdList->type);
+        profileEnter(cmdList);
+        status = execute_node(pcmd);
+        profileLeave(cmdList);
+        statsNode(outer);
+    } else
+        set_status(status);
+
+    if (globbed > 0)
+        freeGlob(&expanded);
+    if (isBound)
+        freeBound(&bound);
+    return status;
+}
 
-        int last_status = execute(pcmd->left,0,0);
-        if (pcmd->right != NULL)   // execute right subtree if exists
-            last_status = execute(pcmd->right,0,0);
 
-        return last_status;
-    }
-    
-    // Backgrounded commands
-    else if (pcmd->type == SEP_BG) {
+// Return the number of commands that OP_PAR may run at once, as set by
+// $PARALLEL (a number, or anything else for the number of processors);
+// 0 if $PARALLEL is not set
+static int parallel_limit (void)
+{
+    char *par = getenv("PARALLEL");
+    if (par == NULL)
+        return 0;
+    if (atoi(par) > 0)
+        return atoi(par);
+    return (int) sysconf(_SC_NPROCESSORS_ONLN);
+}
 
-        if ((pid = fork()) < 0) {
-            perror("SEP_BG: fork failed");
-            return set_status(errno);
+
+// Run the commands of the N OP_RUNs at IP concurrently, at most LIMIT at a
+// time, and return status of the last.  Standard error of each command is
+// held in a temporary file and copied out in order once all are done.
+static int run_parallel (instr *ip, int n, int limit)
+{
+    pid_t *pids = malloc(n * sizeof(pid_t));
+    int *stat   = malloc(n * sizeof(int));
+    FILE **errs = malloc(n * sizeof(FILE *));
+    int running = 0, status;
+    pid_t pid;
+
+    signal(SIGINT,SIG_IGN);
+    fflush(stdout);
+    fflush(stderr);
+
+    for (int i = 0; i < n || running > 0; ) {
+
+        // Start next command
+        if (i < n && running < limit) {
+            errs[i] = tmpfile();
+            if ((pids[i] = perfFork(ip[i].cmd)) < 0) {
+                perror("PARALLEL: fork failed");
+                stat[i] = errno;
+            }
+            else if (pids[i] == 0) {   // child
+                if (errs[i] != NULL)
+                    dup2(fileno(errs[i]), 2);
+                _exit(execute(ip[i].cmd));
+            }
+            else
+                running++;
+            i++;
+            continue;
         }
 
-        else if (pid == 0) { // child executes left subtree
-            _exit(execute(pcmd->left,0,0)); 
+        // Wait for one to finish (reporting backgrounded commands as usual)
+        if ((pid = waitpid((pid_t)(-1), &status, 0)) < 0)
+            break;
+        status = (WIFEXITED(status) ? WEXITSTATUS(status) : 128+WTERMSIG(status));
+
+        int k;
+        for (k = 0; k < i && pids[k] != pid; k++)
+            ;
+        if (k < i) {
+            stat[k] = status;
+            running--;
         }
+        else {
+            fprintf(stderr, "Completed: %d (%d)\n", pid, status);
+            jobReaped(pid);
+        }
+        perfReap(pid);
+    }
+    signal(SIGINT,SIG_DFL);
 
-        else { // parent continues 
-               //  (e.g., executing right subtree or return to main)
-               // Return status of right subtree or 0 if nonexistent
-            fprintf(stderr, "Backgrounded: %d\n", pid);
-            set_status(0);
-            if (pcmd->right != NULL)
-                return execute(pcmd->right,0,0);
+    // Copy standard error of each command in order
+    for (int i = 0; i < n; i++) {
+        if (errs[i] == NULL)
+            continue;
+        char buf[4096];
+        size_t nRead;
+        rewind(errs[i]);
+        while ((nRead = fread(buf, 1, sizeof(buf), errs[i])) > 0)
+            fwrite(buf, 1, nRead, stderr);
+        fclose(errs[i]);
+    }
+
+    status = stat[n-1];
+    free(pids);
+    free(stat);
+    free(errs);
 
-            return 0;
+    return set_status(status);
+}
 
 
+// Run program PROG and return status of last command executed
+int runProgram (program *prog)
+{
+    int status = 0;
+    pid_t pid;
+    int outer;     // Type charged before OP_BG or OP_PAR
+    double launch, forked;  // Times of OP_BG's fork()
+
+    for (int pc = 0; pc < prog->n; pc++) {
+        instr *ip = &prog->code[pc];
+
+        switch (ip->op) {
+
+        case OP_RUN:
+            status = execute(ip->cmd);
+            break;
+
+        // || skips its right operand after success, && after failure;
+        // the skipped operand leaves the status unchanged
+        case OP_JZ:
+            if (status == 0)
+                pc = ip->arg - 1;
+            break;
+
+        case OP_JNZ:
+            if (status != 0)
+                pc = ip->arg - 1;
+            break;
+
+        // Backgrounded commands
+        // Child runs the block up to OP_EXIT; parent skips it with status 0
+        case OP_BG:
+            outer = statsNode(SEP_BG);
+            launch = jobTime();
+            pid = perfFork(ip[1].cmd);
+            forked = jobTime();
+            statsNode(outer);
+            if (pid < 0) {
+                perror("SEP_BG: fork failed");
+                status = set_status(errno);
+                pc = ip->arg - 1;
+            }
+            else if (pid == 0)
+                startChild();
+            else {
+                fprintf(stderr, "Backgrounded: %d\n", pid);
+                jobLaunched(launch, forked);
+                status = set_status(0);
+                pc = ip->arg - 1;
+            }
+            break;
+
+        case OP_EXIT:
+            _exit(status);
+
+        // Independent commands run concurrently if $PARALLEL is set
+        case OP_PAR: {
+            int limit = parallel_limit();
+            if (limit > 1) {
+                outer = statsNode(SEP_END);
+                status = run_parallel(ip + 1, ip->arg, limit);
+                statsNode(outer);
+                pc += ip->arg;
+            }
+            break;
+        }
         }
     }
 
-    else
-        return EXIT_SUCCESS;
+    return status;
+}
+
+
+// Compile and run command list CMDLIST; return status of last command
+static int interpret (CMD *cmdList)
+{
+    program *prog = compile(cmdList);
+    int status = runProgram(prog);
+    freeProgram(prog);
+
+    return status;
 }
 
 void process (CMD *cmdList) 
 {
-    execute(cmdList,0,0);
+    interpret(cmdList);
 }
@@ -0,0 +1,373 @@
+// profile.c                                      Daniel Kim (10/19/26)
+//
+// Profiling of scripts by command line and command.
+//
+// If $PROFILE is set, the wall-clock and CPU time (user plus system, of the
+// shell and of the children it reaps) of each command line and of each simple
+// command in it are measured.  At exit the shell writes the simple commands'
+// times as folded stacks, one per line,
+//
+//   line 12;SEP_AND;PIPE;grep 48211
+//
+// (wall-clock microseconds in the file $PROFILE, CPU microseconds in
+// $PROFILE.cpu), which flame graph tools read, and prints the command lines
+// and the stacks that took longest on stderr.  The frames of a stack are the
+// types of the nodes of the CMD tree above the command, with runs of the
+// same type (as in a | b | c) shown once.
+//
+// A simple command is timed by the process that executes it, which may be a
+// child (a stage of a pipeline or a command in a subshell), so the samples go
+// to a ring in a shared anonymous mapping; the shell drains it after each
+// command line, at exit, and whenever it finds the ring full when adding a
+// sample of its own.  A child that finds the ring full cannot wait (the shell
+// may be waiting for it), so it drops the sample, and the number dropped is
+// reported at exit.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+#define RING   65536             // Samples in shared ring
+#define TOP    15                // Entries in each report
+
+typedef struct {                 // Time taken by one simple command
+    int ready;                   // Fields below written?
+    int line;                    // Command line
+    int leaf;                    // Index in leaves[] of that line, or -1
+    char name[32];               // argv[0] if leaf is -1
+    int64_t wall, cpu;           // Nanoseconds
+} sample;
+
+typedef struct {                 // Folded stack with its total time
+    char *stack;
+    int64_t wall, cpu;
+} entry;
+
+typedef struct {                 // Counts shared with children
+    unsigned added;              // Slots ever claimed
+    unsigned drained;            // Slots ever emptied
+    unsigned lost;               // Samples dropped because the ring was full
+} counts;
+
+static sample *ring = NULL;      // Shared; NULL if not profiling
+static counts *nRing;            // (Also shared)
+static pid_t shell;              // The process that drains the ring
+
+static int line = 0;             // Command line being run
+static CMD **leaves = NULL;      // Its simple commands, and the stacks
+static char **stacks = NULL;     //   above them
+static int nLeaves = 0;
+
+static char ***lineStacks = NULL;  // stacks[] of each line ever run
+static int nLineStacks = 0;
+
+static entry *entries = NULL;    // One per sample drained
+static int nEntries = 0;
+static entry *lines = NULL;      // Time for each command line
+static int nLines = 0;
+
+static int depth = 0;            // Simple commands being executed
+static int64_t startWall, startCpu;
+static int64_t lineWall, lineCpu;
+
+
+
+// Return the wall-clock time in nanoseconds
+static int64_t wall_time (void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (int64_t) t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+
+// Return the CPU time in nanoseconds of this thread and its reaped children
+static int64_t cpu_time (void)
+{
+    struct rusage self, kids;
+    getrusage(RUSAGE_THREAD, &self);
+    getrusage(RUSAGE_CHILDREN, &kids);
+    int64_t us = self.ru_utime.tv_sec * 1000000LL + self.ru_utime.tv_usec
+               + self.ru_stime.tv_sec * 1000000LL + self.ru_stime.tv_usec
+               + kids.ru_utime.tv_sec * 1000000LL + kids.ru_utime.tv_usec
+               + kids.ru_stime.tv_sec * 1000000LL + kids.ru_stime.tv_usec;
+    return us * 1000;
+}
+
+
+// Return the name of node type TYPE
+static const char *type_name (int type)
+{
+    switch (type) {
+    case PIPE:    return "PIPE";
+    case SUBCMD:  return "SUBCMD";
+    case SEP_AND: return "SEP_AND";
+    case SEP_OR:  return "SEP_OR";
+    case SEP_END: return "SEP_END";
+    case SEP_BG:  return "SEP_BG";
+    case WATCH:   return "WATCH";
+    case FANOUT:  return "FANOUT";
+    case FOR:     return "FOR";
+    case WHILE:   return "WHILE";
+    case UNTIL:   return "UNTIL";
+    default:      return "CMD";
+    }
+}
+
+
+// Record the simple commands in the tree C, whose ancestors' frames are PATH
+// and whose parent has type PARENT
+static void find_leaves (CMD *c, const char *path, int parent)
+{
+    if (c == NULL)
+        return;
+
+    if (c->type == SIMPLE) {
+        leaves = realloc(leaves, (nLeaves + 1) * sizeof(CMD *));
+        stacks = realloc(stacks, (nLeaves + 2) * sizeof(char *));
+        leaves[nLeaves] = c;
+        if (asprintf(&stacks[nLeaves], "%s;%s", path, c->argv[0]) == -1)
+            stacks[nLeaves] = strdup(path);
+        stacks[++nLeaves] = NULL;
+        return;
+    }
+
+    char *sub = (char *) path;
+    if (c->type != parent && asprintf(&sub, "%s;%s", path, type_name(c->type)) == -1)
+        sub = (char *) path;
+    find_leaves(c->left, sub, c->type);
+    find_leaves(c->right, sub, c->type);
+    if (sub != path)
+        free(sub);
+}
+
+
+// Return the folded stack for sample S
+static char *stack_of (sample *s)
+{
+    char *stack;
+
+    if (s->line > 0 && s->line < nLineStacks && lineStacks[s->line] && s->leaf >= 0)
+        return strdup(lineStacks[s->line][s->leaf]);
+    if (asprintf(&stack, "line %d;%s", s->line, s->name) == -1)
+        return strdup("?");
+    return stack;
+}
+
+
+// Move the finished samples in the ring to entries[]
+static void drain (void)
+{
+    unsigned drained = nRing->drained;
+    for ( ; drained != __atomic_load_n(&nRing->added, __ATOMIC_ACQUIRE); drained++) {
+        sample *s = &ring[drained % RING];
+        if (!__atomic_load_n(&s->ready, __ATOMIC_ACQUIRE))
+            break;
+        entries = realloc(entries, (nEntries + 1) * sizeof(entry));
+        entries[nEntries++] = (entry) { stack_of(s), s->wall, s->cpu };
+        __atomic_store_n(&s->ready, 0, __ATOMIC_RELEASE);
+        __atomic_store_n(&nRing->drained, drained + 1, __ATOMIC_RELEASE);
+    }
+}
+
+
+// Start profiling if $PROFILE is set; return true if so
+bool startProfile (void)
+{
+    if (getenv("PROFILE") == NULL)
+        return false;
+    void *p = mmap(NULL, RING * sizeof(sample) + sizeof(counts),
+                   PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        perror("PROFILE: mmap failed");
+        return false;
+    }
+    ring = p;
+    nRing = (counts *) (ring + RING);
+    shell = getpid();
+    return true;
+}
+
+
+// Start profiling command line N, whose command is CMD
+void profileLine (int n, CMD *cmd)
+{
+    char frame[32];
+
+    if (ring == NULL)
+        return;
+    drain();
+
+    free(leaves);
+    leaves = NULL;
+    stacks = NULL;
+    nLeaves = 0;
+    sprintf(frame, "line %d", n);
+    find_leaves(cmd, frame, NONE);
+
+    if (n >= nLineStacks) {                             // Stacks are kept for
+        int old = nLineStacks;                          //   samples drained
+        nLineStacks = 2 * n;                            //   later
+        lineStacks = realloc(lineStacks, nLineStacks * sizeof(char **));
+        memset(lineStacks + old, 0, (nLineStacks - old) * sizeof(char **));
+    }
+    lineStacks[n] = stacks;
+
+    line = n;
+    lineWall = wall_time();
+    lineCpu  = cpu_time();
+}
+
+
+// Finish profiling the command line being run
+void profileDone (void)
+{
+    if (ring == NULL)
+        return;
+
+    if (line >= nLines) {
+        int old = nLines;
+        nLines = 2 * line;
+        lines = realloc(lines, nLines * sizeof(entry));
+        memset(lines + old, 0, (nLines - old) * sizeof(entry));
+    }
+    lines[line].wall += wall_time() - lineWall;
+    lines[line].cpu  += cpu_time() - lineCpu;
+}
+
+
+// Called before simple command PCMD is executed
+void profileEnter (CMD *pcmd)
+{
+    if (ring == NULL || pcmd->type != SIMPLE || depth++ > 0)
+        return;                                         // Time outermost only
+    startWall = wall_time();
+    startCpu  = cpu_time();
+}
+
+
+// Called after simple command PCMD is executed: add its sample to the ring
+void profileLeave (CMD *pcmd)
+{
+    if (ring == NULL || pcmd->type != SIMPLE || --depth > 0)
+        return;
+
+    unsigned slot = __atomic_load_n(&nRing->added, __ATOMIC_RELAXED);
+    do {                                                // Claim a free slot
+        if (slot - __atomic_load_n(&nRing->drained, __ATOMIC_ACQUIRE) < RING)
+            continue;
+        if (getpid() == shell)
+            drain();
+        if (slot - __atomic_load_n(&nRing->drained, __ATOMIC_ACQUIRE) >= RING) {
+            __atomic_fetch_add(&nRing->lost, 1, __ATOMIC_RELAXED);
+            return;                                     // (Still full)
+        }
+    } while (!__atomic_compare_exchange_n(&nRing->added, &slot, slot + 1, false,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    sample *s = &ring[slot % RING];
+    s->line = line;
+    s->wall = wall_time() - startWall;
+    s->cpu  = cpu_time() - startCpu;
+    for (s->leaf = 0; s->leaf < nLeaves && leaves[s->leaf] != pcmd; s->leaf++)
+        ;
+    if (s->leaf == nLeaves)
+        s->leaf = -1;
+    snprintf(s->name, sizeof(s->name), "%s", pcmd->argv[0]);
+    __atomic_store_n(&s->ready, 1, __ATOMIC_RELEASE);
+}
+
+
+// Compare entries by stack for qsort()
+static int by_stack (const void *a, const void *b)
+{
+    return strcmp(((const entry *) a)->stack, ((const entry *) b)->stack);
+}
+
+
+// Compare entries by wall-clock time (most first) for qsort()
+static int by_wall (const void *a, const void *b)
+{
+    int64_t x = ((const entry *) a)->wall, y = ((const entry *) b)->wall;
+    return (x < y) - (x > y);
+}
+
+
+// Compare command lines by wall-clock time (most first) for qsort()
+static int by_line (const void *a, const void *b)
+{
+    int64_t x = lines[*(const int *) a].wall, y = lines[*(const int *) b].wall;
+    return (x < y) - (x > y);
+}
+
+
+// Write the folded stacks to $PROFILE and $PROFILE.cpu and print the longest
+// command lines and stacks on stderr
+void reportProfile (void)
+{
+    if (ring == NULL)
+        return;
+    drain();
+
+    // Merge samples with the same stack
+    qsort(entries, nEntries, sizeof(entry), by_stack);
+    int n = 0;
+    for (int i = 0; i < nEntries; i++) {
+        if (n > 0 && strcmp(entries[i].stack, entries[n-1].stack) == 0) {
+            entries[n-1].wall += entries[i].wall;
+            entries[n-1].cpu  += entries[i].cpu;
+            free(entries[i].stack);
+        } else
+            entries[n++] = entries[i];
+    }
+    nEntries = n;
+
+    char *cpuPath;
+    FILE *wall = fopen(getenv("PROFILE"), "w"), *cpu = NULL;
+    if (asprintf(&cpuPath, "%s.cpu", getenv("PROFILE")) != -1) {
+        cpu = fopen(cpuPath, "w");
+        free(cpuPath);
+    }
+    if (wall == NULL || cpu == NULL)
+        perror(getenv("PROFILE"));
+    for (int i = 0; i < nEntries; i++) {
+        if (wall)
+            fprintf(wall, "%s %lld\n", entries[i].stack, (long long) entries[i].wall / 1000);
+        if (cpu)
+            fprintf(cpu, "%s %lld\n", entries[i].stack, (long long) entries[i].cpu / 1000);
+    }
+    if (wall)
+        fclose(wall);
+    if (cpu)
+        fclose(cpu);
+
+    // Longest command lines
+    int *order = malloc((nLines + 1) * sizeof(int));
+    n = 0;
+    for (int i = 1; i < nLines; i++)
+        if (lines[i].wall > 0)
+            order[n++] = i;
+    qsort(order, n, sizeof(int), by_line);
+    fprintf(stderr, "\n%-8s %12s %12s\n", "line", "wall ms", "cpu ms");
+    for (int i = 0; i < n && i < TOP; i++)
+        fprintf(stderr, "%-8d %12.3f %12.3f\n", order[i],
+                lines[order[i]].wall / 1e6, lines[order[i]].cpu / 1e6);
+    free(order);
+
+    // Longest stacks
+    qsort(entries, nEntries, sizeof(entry), by_wall);
+    fprintf(stderr, "\n%12s %12s  %s\n", "wall ms", "cpu ms", "stack");
+    for (int i = 0; i < nEntries && i < TOP; i++)
+        fprintf(stderr, "%12.3f %12.3f  %s\n", entries[i].wall / 1e6,
+                entries[i].cpu / 1e6, entries[i].stack);
+    if (nRing->lost > 0)
+        fprintf(stderr, "profile: %u samples lost (ring full)\n", nRing->lost);
+}
@@ -0,0 +1,28 @@
+# stress.bash                                    Daniel Kim (10/19/26)
+#
+# Workload for "make stress" (see jobstats.c): $SHORT jobs that exit at once,
+# $PIPES backgrounded pipelines, and then $LONG jobs that run for $HOLD
+# seconds, with foreground commands among them (each of which must reap the
+# jobs that have finished before it starts) and a wait at the end that
+# blocks until the long jobs finish.  The foreground commands are on lines
+# of their own, since the time to respond is measured per line.
+for i in $(seq $SHORT); do true & done
+true
+true
+true
+true
+true
+true
+true
+true
+for i in $(seq $PIPES); do seq 1000 | sort -n | wc -l > /dev/null & done
+for i in $(seq $LONG); do sleep $HOLD & done
+true
+true
+true
+true
+true
+true
+true
+true
+wait
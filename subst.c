@@ -0,0 +1,377 @@
+// subst.c                                        Daniel Kim (10/19/26)
+//
+// Command substitution.
+//
+// Before a line is lexed, each $(command list) in it is replaced by a
+// placeholder; lexSubst() then lexes the line and replaces each word that
+// contains placeholders by the words of the outputs (less any trailing
+// newlines, split at blanks and newlines), running each list when its word
+// is reached.  The output is never lexed, so metacharacters and $s in it are
+// just text.  The list is itself expanded when it runs, so substitutions may
+// nest.
+//
+// In a loop, construct() replaces each placeholder by the list itself (in hex
+// between DEFERs, with the loop variables in it marked), so it is not run
+// when the line is read; bindCMD() calls substWord() to run it each time the
+// command that contains it is executed.
+//
+// The list runs in a child whose standard output is a pipe that the shell
+// drains into a buffer that grows as needed.  A list that is just a built-in
+// whose only effect is its output (dirs) is instead run in the shell itself,
+// writing to a memory stream, so no process is created.  Built-ins that act on
+// the shell (cd, wait) or run other commands (memo, timeout) still get a child
+// since a substitution must not change the shell's state.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <sys/wait.h>
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+typedef struct {                 // Growable string
+    char *s;
+    size_t n, max;
+} buffer;
+
+static char **texts = NULL;      // Command lists of the line's substitutions
+static char **outputs = NULL;    // ... and their outputs (NULL until run)
+static int nHoles = 0;
+static int depth = 0;            // Nesting of capture()
+
+
+
+// Append the N bytes at S to B
+static void append (buffer *b, const char *s, size_t n)
+{
+    if (b->n + n + 1 > b->max) {
+        while (b->n + n + 1 > b->max)
+            b->max = (b->max ? 2 * b->max : 256);
+        b->s = realloc(b->s, b->max);
+    }
+    memcpy(b->s + b->n, s, n);
+    b->n += n;
+    b->s[b->n] = '\0';
+}
+
+
+// Return the position of the ) that closes the ( at S, or NULL
+static const char *closing (const char *s)
+{
+    int depth = 0;
+
+    for ( ; *s; s++) {
+        if (*s == '(')
+            depth++;
+        else if (*s == ')' && --depth == 0)
+            return s;
+    }
+    return NULL;
+}
+
+
+// Run command CMD in the shell if it is a built-in without side effects,
+// appending its output to OUT; return false if it needs a child
+static bool run_builtin (CMD *cmd, buffer *out)
+{
+    if (cmd->type != SIMPLE || cmd->fromType != NONE || cmd->toType != NONE
+          || strcmp(cmd->argv[0], "dirs") != 0)
+        return false;
+
+    char *text = NULL;
+    size_t n = 0;
+    FILE *fp = open_memstream(&text, &n);
+    if (fp == NULL)
+        return false;
+    dirs(cmd, fp);
+    fclose(fp);
+    append(out, text, n);
+    free(text);
+    return true;
+}
+
+
+// Run command list CMD in a child, appending its output to OUT
+static void run_child (CMD *cmd, buffer *out)
+{
+    int fd[2];
+    pid_t pid;
+
+    if (pipe(fd) == -1) {
+        perror("$(): pipe failed");
+        return;
+    }
+    fflush(stdout);                          // Children inherit buffer
+    if ((pid = perfFork(cmd)) < 0) {
+        perror("$(): fork failed");
+        close(fd[0]);
+        close(fd[1]);
+        return;
+    }
+
+    else if (pid == 0) {     // child
+        startChild();
+        close(fd[0]);
+        if (fd[1] != STDOUT_FILENO) {
+            dup2(fd[1], STDOUT_FILENO);
+            close(fd[1]);
+        }
+        program *prog = compile(cmd);
+        int status = runProgram(prog);
+        fflush(stdout);
+        _exit(status);
+    }
+
+    // parent: read until the child and its descendants close the pipe
+    close(fd[1]);
+    char chunk[BUFSIZ];
+    ssize_t got;
+    while ((got = read(fd[0], chunk, sizeof(chunk))) != 0) {
+        if (got > 0)
+            append(out, chunk, got);
+        else if (errno != EINTR)
+            break;
+    }
+    close(fd[0]);
+
+    int status;
+    signal(SIGINT,SIG_IGN);
+    waitChild(pid, &status);
+    perfReap(pid);
+    signal(SIGINT,SIG_DFL);
+}
+
+
+// Return the output of command list TEXT, less any trailing newlines
+static char *capture (const char *text)
+{
+    buffer out = { NULL, 0, 0 };
+
+    depth++;
+    append(&out, "", 0);
+    char *expanded = substitute(strdup(text));
+    token *list = lexSubst(expanded);
+    free(expanded);
+    CMD *cmd = (list ? parse(list) : NULL);
+    freeList(list);
+
+    if (cmd != NULL && !run_builtin(cmd, &out))
+        run_child(cmd, &out);
+    freeCMD(cmd);
+    depth--;
+
+    while (out.n > 0 && out.s[out.n-1] == '\n')
+        out.s[--out.n] = '\0';
+    return out.s;
+}
+
+
+// Forget the substitutions of the last line, unless one of them is running
+static void forget (void)
+{
+    if (depth > 0)
+        return;
+    for (int i = 0; i < nHoles; i++) {
+        free(texts[i]);
+        free(outputs[i]);
+    }
+    nHoles = 0;
+}
+
+
+// Append to B a placeholder for command list TEXT (which is kept)
+static void add_hole (buffer *b, char *text)
+{
+    texts = realloc(texts, (nHoles + 1) * sizeof(char *));
+    outputs = realloc(outputs, (nHoles + 1) * sizeof(char *));
+    texts[nHoles] = text;
+    outputs[nHoles] = NULL;
+
+    char hole[16];
+    int n = snprintf(hole, sizeof(hole), "%c%d%c", HOLE, nHoles++, HOLE);
+    append(b, hole, n);
+}
+
+
+// Return the output of placeholder I, running its command list if need be
+static const char *output (int i)
+{
+    if (i < 0 || i >= nHoles)
+        return "";
+    if (outputs[i] == NULL) {
+        char *text = capture(texts[i]);                 // (May add holes)
+        outputs[i] = text;
+    }
+    return outputs[i];
+}
+
+
+// Return LINE with each $(command list) replaced by a placeholder for its
+// output; LINE is either returned or freed.  An unmatched $( is left for
+// parse() to report.
+char *substitute (char *line)
+{
+    forget();                                           // A new line?
+    char *p = strstr(line, "$(");
+    if (p == NULL)
+        return line;
+
+    buffer out = { NULL, 0, 0 };
+    char *rest = line;
+    for ( ; p != NULL; p = strstr(rest, "$(")) {
+        const char *end = closing(p + 1);
+        if (end == NULL)
+            break;
+        append(&out, rest, p - rest);
+        add_hole(&out, strndup(p + 2, end - (p + 2)));
+        rest = (char *) end + 1;
+    }
+    append(&out, rest, strlen(rest));
+    free(line);
+    return out.s;
+}
+
+
+// If a placeholder begins at P, set *END just past it and return its command
+// list (which has not been run); else return NULL
+const char *holeText (const char *p, const char **end)
+{
+    const char *close;
+    int i;
+
+    if (*p != HOLE || (close = strchr(p + 1, HOLE)) == NULL
+          || (i = atoi(p + 1)) < 0 || i >= nHoles || outputs[i] != NULL)
+        return NULL;
+    *end = close + 1;
+    return texts[i];
+}
+
+
+// Append a word token with text B->S to the list ending at *LAST and empty B
+static void add_word (token ***last, buffer *b)
+{
+    token *t = malloc(sizeof(token));
+    *t = (token) { strdup(b->s ? b->s : ""), SIMPLE, NULL };
+    **last = t;
+    *last = &t->next;
+    b->n = 0;
+}
+
+
+// Is WORD of the form NAME=VALUE?
+static bool assignment (const char *word)
+{
+    size_t name = strspn(word, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz_0123456789");
+    return (name > 0 && !isdigit(word[0]) && word[name] == '=');
+}
+
+
+// Return the list of words into which WORD (with placeholders) expands; if
+// ASSIGN the outputs are not split
+static token *split (const char *word, bool assign)
+{
+    token *words = NULL, **last = &words;
+    buffer b = { NULL, 0, 0 };
+    bool have = false;                                  // A word begun?
+
+    for (const char *p = word; *p; ) {
+        char *end;
+        if (*p == HOLE && (end = strchr(p + 1, HOLE)) != NULL) {
+            for (const char *q = output(atoi(p + 1)); *q; q++)
+                if (!assign && strchr(" \t\n", *q)) {
+                    if (have)
+                        add_word(&last, &b);
+                    have = false;
+                } else {
+                    append(&b, q, 1);
+                    have = true;
+                }
+            p = end + 1;
+        } else {
+            append(&b, p++, 1);
+            have = true;
+        }
+    }
+    if (have)
+        add_word(&last, &b);
+    free(b.s);
+    return words;
+}
+
+
+// Lex TEXT (as returned by substitute()), replacing each word that contains
+// placeholders by the words of the outputs (just one word for the value of a
+// local variable)
+token *lexSubst (const char *text)
+{
+    token *list = lex(text);
+    if (strchr(text, HOLE) == NULL)                     // (Parse-ahead thread)
+        return list;
+
+    bool locals = true;                                 // Before command name?
+    for (token **t = &list; *t; ) {
+        int type = (*t)->type;
+        if (type == PIPE || type == SEP_END || type == SEP_BG || type == SEP_AND
+              || type == SEP_OR || type == PAR_LEFT)
+            locals = true;
+        else if (type == SIMPLE && !assignment((*t)->text))
+            locals = false;
+        if (type != SIMPLE || strchr((*t)->text, HOLE) == NULL) {
+            t = &(*t)->next;
+            continue;
+        }
+        token *old = *t, *words = split(old->text, locals && assignment(old->text));
+        *t = words;
+        while (*t)
+            t = &(*t)->next;
+        *t = old->next;
+        old->next = NULL;
+        freeList(old);
+    }
+    return list;
+}
+
+
+// Return the text that the hex digits from P to END encode
+static char *decode (const char *p, const char *end)
+{
+    size_t n = (end - p) / 2;
+    char *text = malloc(n + 1);
+
+    for (size_t i = 0; i < n; i++) {
+        unsigned byte;
+        sscanf(p + 2 * i, "%2x", &byte);
+        text[i] = byte;
+    }
+    text[n] = '\0';
+    return text;
+}
+
+
+// Return the list of words into which WORD expands when each deferred $(...)
+// in it is run now; if ASSIGN the outputs are not split (so there is at most
+// one word)
+token *substWord (const char *word, bool assign)
+{
+    buffer b = { NULL, 0, 0 };
+    const char *end;
+
+    forget();
+    append(&b, "", 0);
+    for (const char *p = word; *p; )
+        if (*p == DEFER && (end = strchr(p + 1, DEFER)) != NULL) {
+            add_hole(&b, decode(p + 1, end));
+            p = end + 1;
+        } else
+            append(&b, p++, 1);
+
+    token *words = split(b.s, assign);
+    free(b.s);
+    return words;
+}
@@ -0,0 +1,387 @@
+// sysstats.c                                     Daniel Kim (10/19/26)
+//
+// Accounting of the system calls that the shell itself makes.
+//
+// If $SYSCALL_STATS is set, each call that the shell makes to one of the
+// functions in callName[] is counted and timed, by node type (the type of the
+// command being executed, or "main" outside any command) and by command line,
+// and a summary is printed on stderr at exit.  The wrappers are interposed
+// with the linker's --wrap option (see the Makefile), so the calls themselves
+// are written as usual; when accounting is off a wrapper costs one test.
+//
+// The tallies by node type live in a shared anonymous mapping updated with
+// atomic adds, so that the calls a child makes between fork() and exec()
+// (redirection, local variables, pipeline plumbing) are charged to the shell
+// as well; what a command does once exec()ed is not.  Time spent blocked in
+// waitpid() or epoll_wait() is waiting for children, not overhead, and is
+// listed separately.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+enum { C_FORK, C_EXECVP, C_WAITPID, C_WAIT, C_SIGNAL, C_SETENV, C_DUP, C_DUP2,
+       C_CLOSE, C_OPEN, C_PIPE, C_CHDIR, C_GETCWD, C_KILL, C_SETPGID,
+       C_TCSETPGRP, C_EPOLL_WAIT, NCALLS };
+
+static const char *callName[NCALLS] = {
+    "fork", "execvp", "waitpid", "waitpid*", "signal", "setenv", "dup", "dup2",
+    "close", "open", "pipe", "chdir", "getcwd", "kill", "setpgid",
+    "tcsetpgrp", "epoll_wait*" };
+
+enum { N_MAIN, N_SIMPLE, N_PIPE, N_SUBCMD, N_BG, N_PAR, NNODES };
+
+static const char *nodeName[NNODES] = {
+    "main", "SIMPLE", "PIPE", "SUBCMD", "SEP_BG", "PARALLEL" };
+
+typedef struct {
+    uint64_t n;                  // Calls
+    uint64_t ns;                 // Time spent in them
+} tally;
+
+static tally (*table)[NCALLS] = NULL;    // [NNODES][NCALLS], shared; NULL
+                                         //   if accounting is off
+static int node = NONE;                  // Type of command being executed
+
+static tally *lines = NULL;              // Overhead by command line
+static int nLines = 0;
+static int line = 0;                     // Line being charged
+static tally seen;                       // Overhead when it began
+
+
+
+// Return the current time in nanoseconds
+static uint64_t now (void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+
+// Return the row of table[] for command type TYPE
+static int row (int type)
+{
+    switch (type) {
+    case SIMPLE:  return N_SIMPLE;
+    case PIPE:    return N_PIPE;
+    case SUBCMD:  return N_SUBCMD;
+    case SEP_BG:  return N_BG;
+    case SEP_END: return N_PAR;
+    default:      return N_MAIN;
+    }
+}
+
+
+// Charge a call to CALL that began at time START
+static void charge (int call, uint64_t start)
+{
+    tally *t = &table[row(node)][call];
+    __atomic_fetch_add(&t->n, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&t->ns, now() - start, __ATOMIC_RELAXED);
+}
+
+
+// Return the total overhead (calls other than waits) so far
+static tally overhead (void)
+{
+    tally sum = { 0, 0 };
+    for (int i = 0; i < NNODES; i++)
+        for (int j = 0; j < NCALLS; j++)
+            if (j != C_WAIT && j != C_EPOLL_WAIT) {
+                sum.n  += __atomic_load_n(&table[i][j].n, __ATOMIC_RELAXED);
+                sum.ns += __atomic_load_n(&table[i][j].ns, __ATOMIC_RELAXED);
+            }
+    return sum;
+}
+
+
+// Start accounting if $SYSCALL_STATS is set
+void startStats (void)
+{
+    if (getenv("SYSCALL_STATS") == NULL)
+        return;
+    void *p = mmap(NULL, NNODES * sizeof(*table), PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        perror("SYSCALL_STATS: mmap failed");
+    else
+        table = p;
+}
+
+
+// Charge the calls that follow to command type TYPE; return the type that
+// they were charged to before
+int statsNode (int type)
+{
+    int outer = node;
+    node = type;
+    return outer;
+}
+
+
+// Charge the overhead that follows to command line N (N = 0 at the end)
+void statsLine (int n)
+{
+    if (table == NULL)
+        return;
+
+    tally sum = overhead();
+    if (line > 0) {
+        if (line >= nLines) {
+            int old = nLines;
+            nLines = 2 * line;
+            lines = realloc(lines, nLines * sizeof(tally));
+            memset(lines + old, 0, (nLines - old) * sizeof(tally));
+        }
+        lines[line].n  += sum.n - seen.n;
+        lines[line].ns += sum.ns - seen.ns;
+    }
+    seen = sum;
+    line = n;
+}
+
+
+// Compare lines by overhead (most first) for qsort()
+static int by_time (const void *a, const void *b)
+{
+    const tally *x = *(tally *const *) a, *y = *(tally *const *) b;
+    return (x->ns < y->ns) - (x->ns > y->ns);
+}
+
+
+// Print the summary of the calls made so far on stderr
+void reportStats (void)
+{
+    if (table == NULL)
+        return;
+    statsLine(0);
+
+    fprintf(stderr, "\n%-12s %-9s %10s %12s %10s\n",
+            "call", "node", "calls", "usec", "usec/call");
+    for (int j = 0; j < NCALLS; j++)
+        for (int i = 0; i < NNODES; i++) {
+            tally *t = &table[i][j];
+            if (t->n > 0)
+                fprintf(stderr, "%-12s %-9s %10llu %12.1f %10.2f\n",
+                        callName[j], nodeName[i], (unsigned long long) t->n,
+                        t->ns / 1e3, t->ns / 1e3 / t->n);
+        }
+    tally sum = overhead();
+    fprintf(stderr, "%-22s %10llu %12.1f   (* waits for children, not included)\n",
+            "overhead", (unsigned long long) sum.n, sum.ns / 1e3);
+
+    // Busiest command lines
+    tally **order = malloc((nLines + 1) * sizeof(tally *));
+    int n = 0;
+    for (int i = 1; i < nLines; i++)
+        if (lines[i].n > 0)
+            order[n++] = &lines[i];
+    qsort(order, n, sizeof(tally *), by_time);
+    if (n > 0)
+        fprintf(stderr, "\n%-8s %10s %12s\n", "line", "calls", "usec");
+    for (int i = 0; i < n && i < 20; i++)
+        fprintf(stderr, "%-8d %10llu %12.1f\n", (int) (order[i] - lines),
+                (unsigned long long) order[i]->n, order[i]->ns / 1e3);
+    if (n > 20)
+        fprintf(stderr, "(%d more lines)\n", n - 20);
+    free(order);
+}
+
+
+
+// The wrappers, each of which calls the real function __real_NAME()
+
+pid_t __real_fork (void);
+pid_t __wrap_fork (void)
+{
+    if (table == NULL)
+        return __real_fork();
+    uint64_t t = now();
+    pid_t pid = __real_fork();
+    if (pid != 0)                                       // Once, in the parent
+        charge(C_FORK, t);
+    return pid;
+}
+
+int __real_execvp (const char *file, char *const argv[]);
+int __wrap_execvp (const char *file, char *const argv[])
+{
+    if (table != NULL)                                  // Counted as it starts
+        charge(C_EXECVP, now());
+    return __real_execvp(file, argv);
+}
+
+pid_t __real_waitpid (pid_t pid, int *status, int options);
+pid_t __wrap_waitpid (pid_t pid, int *status, int options)
+{
+    if (table == NULL)
+        return __real_waitpid(pid, status, options);
+    uint64_t t = now();
+    pid_t done = __real_waitpid(pid, status, options);
+    charge((options & WNOHANG) ? C_WAITPID : C_WAIT, t);
+    return done;
+}
+
+sighandler_t __real_signal (int sig, sighandler_t handler);
+sighandler_t __wrap_signal (int sig, sighandler_t handler)
+{
+    if (table == NULL)
+        return __real_signal(sig, handler);
+    uint64_t t = now();
+    sighandler_t old = __real_signal(sig, handler);
+    charge(C_SIGNAL, t);
+    return old;
+}
+
+int __real_setenv (const char *name, const char *value, int overwrite);
+int __wrap_setenv (const char *name, const char *value, int overwrite)
+{
+    if (table == NULL)
+        return __real_setenv(name, value, overwrite);
+    uint64_t t = now();
+    int r = __real_setenv(name, value, overwrite);
+    charge(C_SETENV, t);
+    return r;
+}
+
+int __real_dup (int fd);
+int __wrap_dup (int fd)
+{
+    if (table == NULL)
+        return __real_dup(fd);
+    uint64_t t = now();
+    int r = __real_dup(fd);
+    charge(C_DUP, t);
+    return r;
+}
+
+int __real_dup2 (int fd, int fd2);
+int __wrap_dup2 (int fd, int fd2)
+{
+    if (table == NULL)
+        return __real_dup2(fd, fd2);
+    uint64_t t = now();
+    int r = __real_dup2(fd, fd2);
+    charge(C_DUP2, t);
+    return r;
+}
+
+int __real_close (int fd);
+int __wrap_close (int fd)
+{
+    if (table == NULL)
+        return __real_close(fd);
+    uint64_t t = now();
+    int r = __real_close(fd);
+    charge(C_CLOSE, t);
+    return r;
+}
+
+int __real_open (const char *path, int flags, ...);
+int __wrap_open (const char *path, int flags, ...)
+{
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+    if (table == NULL)
+        return __real_open(path, flags, mode);
+    uint64_t t = now();
+    int r = __real_open(path, flags, mode);
+    charge(C_OPEN, t);
+    return r;
+}
+
+int __real_pipe (int fd[2]);
+int __wrap_pipe (int fd[2])
+{
+    if (table == NULL)
+        return __real_pipe(fd);
+    uint64_t t = now();
+    int r = __real_pipe(fd);
+    charge(C_PIPE, t);
+    return r;
+}
+
+int __real_chdir (const char *path);
+int __wrap_chdir (const char *path)
+{
+    if (table == NULL)
+        return __real_chdir(path);
+    uint64_t t = now();
+    int r = __real_chdir(path);
+    charge(C_CHDIR, t);
+    return r;
+}
+
+char *__real_getcwd (char *buf, size_t size);
+char *__wrap_getcwd (char *buf, size_t size)
+{
+    if (table == NULL)
+        return __real_getcwd(buf, size);
+    uint64_t t = now();
+    char *r = __real_getcwd(buf, size);
+    charge(C_GETCWD, t);
+    return r;
+}
+
+int __real_kill (pid_t pid, int sig);
+int __wrap_kill (pid_t pid, int sig)
+{
+    if (table == NULL)
+        return __real_kill(pid, sig);
+    uint64_t t = now();
+    int r = __real_kill(pid, sig);
+    charge(C_KILL, t);
+    return r;
+}
+
+int __real_setpgid (pid_t pid, pid_t pgid);
+int __wrap_setpgid (pid_t pid, pid_t pgid)
+{
+    if (table == NULL)
+        return __real_setpgid(pid, pgid);
+    uint64_t t = now();
+    int r = __real_setpgid(pid, pgid);
+    charge(C_SETPGID, t);
+    return r;
+}
+
+int __real_tcsetpgrp (int fd, pid_t pgrp);
+int __wrap_tcsetpgrp (int fd, pid_t pgrp)
+{
+    if (table == NULL)
+        return __real_tcsetpgrp(fd, pgrp);
+    uint64_t t = now();
+    int r = __real_tcsetpgrp(fd, pgrp);
+    charge(C_TCSETPGRP, t);
+    return r;
+}
+
+int __real_epoll_wait (int ep, struct epoll_event *ev, int max, int timeout);
+int __wrap_epoll_wait (int ep, struct epoll_event *ev, int max, int timeout)
+{
+    if (table == NULL)
+        return __real_epoll_wait(ep, ev, max, timeout);
+    uint64_t t = now();
+    int r = __real_epoll_wait(ep, ev, max, timeout);
+    charge(C_EPOLL_WAIT, t);
+    return r;
+}
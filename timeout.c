@@ -0,0 +1,198 @@
+// timeout.c                                      Daniel Kim (10/19/26)
+//
+// Deadlines for foreground commands.
+//
+//   timeout [-k GRACE] DURATION command [arg]...
+//
+// runs command and, if it has not finished within DURATION, sends SIGTERM
+// to its process group, then SIGKILL if it is still running GRACE later
+// (default 1s); its status is then 124.  Durations are numbers of seconds
+// with an optional suffix s, m, h, or d.  Setting $TIMEOUT gives every
+// foreground command run by the shell itself the same deadline.
+//
+// While a deadline is in force, each child starts its own process group
+// (which also holds the later stages of a pipeline) and the shell waits with
+// epoll on a pidfd for the child and a timerfd for the deadline, so it
+// neither polls nor depends on signals to wake up.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+#define TIMED_OUT  124           // Status of a command that timed out
+
+static double limit = 0;         // Deadline (seconds) set by timeout, or 0
+static double grace = 1;         // Delay from SIGTERM to SIGKILL
+static bool useDefault = true;   // Does $TIMEOUT apply? (Not in children)
+
+
+
+// Return the number of seconds in duration S, or -1 if it is malformed
+static double duration (const char *s)
+{
+    char *end;
+    double d = strtod(s, &end);
+
+    if (end == s || d < 0)
+        return -1;
+    switch (*end) {
+    case '\0': case 's':           break;
+    case 'm':  d *= 60;            break;
+    case 'h':  d *= 60 * 60;       break;
+    case 'd':  d *= 60 * 60 * 24;  break;
+    default:   return -1;
+    }
+    return (*end && end[1] ? -1 : d);
+}
+
+
+// Return the deadline in force for the next foreground command, or 0
+static double deadline (void)
+{
+    if (limit > 0)
+        return limit;
+    if (useDefault && getenv("TIMEOUT"))
+        return (duration(getenv("TIMEOUT")) > 0 ? duration(getenv("TIMEOUT")) : 0);
+    return 0;
+}
+
+
+// Arm timer TFD to expire once after SECONDS
+static void arm (int tfd, double seconds)
+{
+    struct itimerspec it = { { 0, 0 }, { 0, 0 } };
+    it.it_value.tv_sec  = (time_t) seconds;
+    it.it_value.tv_nsec = (long) ((seconds - (time_t) seconds) * 1e9);
+    if (it.it_value.tv_sec == 0 && it.it_value.tv_nsec == 0)
+        it.it_value.tv_nsec = 1;
+    timerfd_settime(tfd, 0, &it, NULL);
+}
+
+
+// Called in each child just after fork(): put the child in its own process
+// group if it will run under a deadline; deadlines do not pass to children
+void startChild (void)
+{
+    if (deadline() > 0)
+        setpgid(0, 0);
+    limit = 0;
+    useDefault = false;
+}
+
+
+// Wait for child PID as waitpid(PID, STATUS, 0) would, but enforce the
+// deadline in force (if any), in which case *STATUS shows exit status 124
+pid_t waitChild (pid_t pid, int *status)
+{
+    double seconds = deadline();
+    pid_t done;
+
+    if (seconds <= 0) {
+        while ((done = waitpid(pid, status, 0)) == -1 && errno == EINTR)
+            ;
+        return done;
+    }
+
+    // Child's group gets the terminal while it runs
+    setpgid(pid, pid);
+    bool term = (isatty(STDIN_FILENO) && tcgetpgrp(STDIN_FILENO) == getpgrp());
+    void (*ttou)(int) = signal(SIGTTOU, SIG_IGN);
+    if (term)
+        tcsetpgrp(STDIN_FILENO, pid);
+
+    int pfd = syscall(SYS_pidfd_open, pid, 0);
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    int ep  = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = { .events = EPOLLIN };
+    ev.data.fd = tfd;
+    epoll_ctl(ep, EPOLL_CTL_ADD, tfd, &ev);
+    if (pfd != -1) {
+        ev.data.fd = pfd;
+        epoll_ctl(ep, EPOLL_CTL_ADD, pfd, &ev);
+    }
+    arm(tfd, seconds);
+
+    int signals = 0;             // Signals sent so far
+    done = 0;
+    while (done == 0) {
+        // Without pidfd_open() (Linux < 5.3), check every 10 ms
+        int n = epoll_wait(ep, &ev, 1, (pfd == -1 ? 10 : -1));
+        if (n == -1 && errno != EINTR)
+            break;
+        if (pfd != -1 ? (n == 1 && ev.data.fd == pfd)
+                      : (done = waitpid(pid, status, WNOHANG)) != 0)
+            break;
+
+        if (n == 1 && ev.data.fd == tfd) {
+            uint64_t expired;
+            if (read(tfd, &expired, sizeof(expired)) == -1)
+                ;
+            if (signals++ == 0) {
+                kill(-pid, SIGTERM);
+                kill(-pid, SIGCONT);
+                arm(tfd, grace);
+            } else {
+                kill(-pid, SIGKILL);
+            }
+        }
+    }
+    while (done == 0 && (done = waitpid(pid, status, 0)) == -1 && errno == EINTR)
+        done = 0;
+
+    if (pfd != -1)
+        close(pfd);
+    close(tfd);
+    close(ep);
+    if (term)
+        tcsetpgrp(STDIN_FILENO, getpgrp());
+    signal(SIGTTOU, ttou);
+
+    if (signals > 0) {
+        fprintf(stderr, "timeout: %d killed after %gs\n", pid, seconds);
+        *status = W_EXITCODE(TIMED_OUT, 0);
+    }
+    return done;
+}
+
+
+// Execute timeout command PCMD, running the command it names with RUN;
+// return its status
+int timeout (CMD *pcmd, int (*run) (CMD *))
+{
+    double secs, after = 1;
+    int i = 1;
+
+    if (i + 1 < pcmd->argc && strcmp(pcmd->argv[i], "-k") == 0) {
+        after = duration(pcmd->argv[i+1]);
+        i += 2;
+    }
+    if (i + 1 >= pcmd->argc || after < 0 || (secs = duration(pcmd->argv[i])) < 0) {
+        fprintf(stderr, "usage: timeout [-k GRACE] DURATION command [arg]...\n");
+        return 1;
+    }
+
+    CMD inner = *pcmd;                                  // The command itself
+    inner.argv += i + 1;
+    inner.argc -= i + 1;
+
+    double saveLimit = limit, saveGrace = grace;
+    limit = (secs > 0 ? secs : 0);
+    grace = after;
+    int status = run(&inner);
+    limit = saveLimit;
+    grace = saveGrace;
+
+    return status;
+}
@@ -0,0 +1,235 @@
+// watch.c                                        Daniel Kim (10/19/26)
+//
+// The watch built-in.
+//
+//   watch [-d MS] PATH... -- command list
+//
+// runs the command list, then again each time a file named by a PATH (or an
+// entry in a directory named by one) is written, created, deleted, renamed,
+// or has its attributes changed, until it is interrupted; its status is that
+// of the last run.  The shell sleeps in poll() on an inotify descriptor, so
+// watching costs nothing while nothing changes.  A PATH that is deleted or
+// replaced by a rename (as most editors save) is watched again under its
+// name, or, while nothing has that name, its directory is watched for one to
+// appear.  Once a change is seen, the run starts when no further event has
+// arrived for MS milliseconds (default 50), so that a burst (an editor saving
+// a file, a make writing many) causes one run.  Runs never overlap: the
+// changes made while the list runs (including any that it makes itself)
+// cause one more run after it.  Each run is reported on stderr with the time
+// from the change to the start of the run and the time the run took:
+//
+//   watch: src/main.c changed (3 events); started after 51 ms, ran 240 ms, status 0
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <time.h>
+#include <libgen.h>
+#include <sys/inotify.h>
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+#define EVENTS  (IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE \
+                 | IN_DELETE_SELF | IN_MOVED_FROM | IN_MOVED_TO | IN_MOVE_SELF)
+#define APPEAR  (IN_CREATE | IN_MOVED_TO | IN_MASK_ADD)     // In directory
+#define STOPPED  (128 + SIGINT)  // Status of a run stopped by SIGINT
+
+typedef struct {                 // A path being watched
+    int wd;                      // Its watch descriptor (-1 if it is gone)
+    int dir;                     // Its directory's while it is gone (or -1)
+    const char *path;
+} watched;
+
+static volatile sig_atomic_t stop = 0;   // SIGINT received while waiting?
+
+
+
+// Return the current time in milliseconds
+static double now (void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+
+// Handle SIGINT while waiting by asking to stop
+static void interrupt (int sig)
+{
+    stop = 1;
+}
+
+
+// Does NAME name the last component of PATH?
+static bool names (const char *path, const char *name)
+{
+    char *copy = strdup(path);
+    bool same = (strcmp(basename(copy), name) == 0);
+    free(copy);
+    return same;
+}
+
+
+// Watch path W on inotify descriptor IN again if it exists, else watch its
+// directory for it to appear; return false if neither can be watched
+static bool rewatch (int in, watched *w)
+{
+    if ((w->wd = inotify_add_watch(in, w->path, EVENTS)) >= 0)
+        return true;
+    if (w->dir < 0) {
+        char *copy = strdup(w->path);
+        w->dir = inotify_add_watch(in, dirname(copy), APPEAR);
+        free(copy);
+    }
+    return w->dir >= 0;
+}
+
+
+// Read the events waiting on inotify descriptor IN; if *WHAT is empty, set it
+// to the path that the first one names, using the N paths in W[].  Watch again
+// the paths that have gone or reappeared.  Return the number of events that
+// changed a path, or -1 if no path can be watched any longer.
+static int drain (int in, watched *w, int n, char *what, size_t size)
+{
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    int count = 0;
+
+    while ((len = read(in, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + len; ) {
+            struct inotify_event *e = (struct inotify_event *) p;
+            p += sizeof(*e) + e->len;
+            bool change = false;
+            for (int i = 0; i < n; i++) {
+                const char *name = "";
+                if (w[i].wd == e->wd) {
+                    if (e->mask & IN_MOVE_SELF)         // (Watch would follow
+                        inotify_rm_watch(in, w[i].wd);  //   the old file)
+                    if (e->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF))
+                        w[i].wd = -1;
+                    if (e->mask & IN_IGNORED)
+                        continue;
+                    if (e->len > 0)
+                        name = e->name;
+                } else if (w[i].wd < 0 && w[i].dir == e->wd && e->len > 0
+                             && names(w[i].path, e->name))
+                    w[i].dir = -1;                      // Has reappeared
+                else
+                    continue;
+                change = true;
+                if (*what == '\0')
+                    snprintf(what, size, "%s%s%s", w[i].path, (*name ? "/" : ""), name);
+            }
+            count += change;
+        }
+    }
+
+    int live = 0;
+    for (int i = 0; i < n; i++)
+        live += (w[i].wd >= 0 || rewatch(in, &w[i]));
+    return (live > 0 ? count : -1);
+}
+
+
+// Wait until inotify descriptor IN is readable, or at most MS milliseconds
+// if MS >= 0; return false if interrupted by SIGINT or if MS elapsed
+static bool await (int in, int ms)
+{
+    struct pollfd p = { in, POLLIN, 0 };
+    struct sigaction sa, old;
+    int ready;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = interrupt;                          // (No SA_RESTART, so
+    sigaction(SIGINT, &sa, &old);                       //   poll() returns)
+    while ((ready = poll(&p, 1, ms)) == -1 && errno == EINTR && !stop)
+        ;
+    sigaction(SIGINT, &old, NULL);
+    return ready > 0 && !stop;
+}
+
+
+// Execute watch command PCMD, running its command list with RUN; return the
+// status of the last run
+int watch (CMD *pcmd, int (*run) (CMD *))
+{
+    int debounce = 50;
+    int first = 1;
+
+    if (pcmd->argc > 2 && strcmp(pcmd->argv[1], "-d") == 0) {
+        char *end;
+        debounce = strtol(pcmd->argv[2], &end, 10);
+        if (*end != '\0' || debounce < 0) {
+            fprintf(stderr, "watch: %s: invalid delay\n", pcmd->argv[2]);
+            return 1;
+        }
+        first = 3;
+    }
+    if (first >= pcmd->argc) {
+        fprintf(stderr, "usage: watch [-d MS] PATH... -- command list\n");
+        return 1;
+    }
+
+    int in = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (in < 0) {
+        perror("watch: inotify_init1 failed");
+        return 1;
+    }
+    int n = 0;
+    watched *w = malloc((pcmd->argc - first) * sizeof(watched));
+    for (int i = first; i < pcmd->argc; i++) {
+        w[n].path = pcmd->argv[i];
+        w[n].dir = -1;
+        if ((w[n].wd = inotify_add_watch(in, w[n].path, EVENTS)) < 0)
+            perror(w[n].path);
+        else
+            n++;
+    }
+    if (n == 0) {
+        free(w);
+        close(in);
+        return 1;
+    }
+
+    stop = 0;
+    int status = run(pcmd->left);
+    double end = now();                                 // End of last run
+    bool during = await(in, 0);                         // Changed during it?
+    while (status != STOPPED && (during || await(in, -1))) {
+        char what[PATH_MAX] = "";
+        double seen = (during ? end : now());
+        during = false;
+
+        int events = drain(in, w, n, what, sizeof(what)), more = 0;
+        while (events >= 0 && await(in, debounce)       // Until quiet
+                 && (more = drain(in, w, n, what, sizeof(what))) >= 0)
+            events += more;
+        if (events < 0 || more < 0) {
+            fprintf(stderr, "watch: nothing left to watch\n");
+            break;
+        }
+        if (stop)
+            break;
+        if (events == 0)                                // (Only IN_IGNORED)
+            continue;
+
+        double start = now();
+        status = run(pcmd->left);
+        end = now();
+        during = await(in, 0);
+        fprintf(stderr, "watch: %s changed (%d event%s); started after %.0f ms,"
+                " ran %.0f ms, status %d\n", what, events, (events == 1 ? "" : "s"),
+                start - seen, end - start, status);
+    }
+
+    free(w);
+    close(in);
+    return status;
+}
@@ -0,0 +1,348 @@
+// xargs.c                                        Daniel Kim (10/19/26)
+//
+// xargs: the built-in command
+//
+//   xargs [-n MAX] [-P PROCS] [command [initial-arg]...]
+//
+// runs command (default echo) with the initial args followed by as many
+// lines of its standard input as fit on one command line, as often as needed
+// to use every line.  A command line is limited by sysconf(_SC_ARG_MAX) less
+// the space that the environment takes, and to MAX lines if -n is given.  Up
+// to PROCS command lines (default 1; 0 means no limit) run at once.
+//
+// The input is mmap()ed when it is a regular file (from its current offset,
+// which is then moved just past the last line used, so that what a shell
+// reading the same file would read next is left for it) and read into one
+// buffer otherwise, and lines are split in place, so each argument points into
+// the input rather than being copied.  The commands' standard input is
+// /dev/null.
+//
+// Children are reaped with waitpid(-1) like other commands, so backgrounded
+// commands that finish meanwhile are reported as usual.  As in GNU xargs the
+// status is 0 if every command line succeeded, 123 if some exited with status
+// 1-125, 124 if one exited with status 255, 125 if one was killed, and 126 or
+// 127 if the command could not be run or found; after 124-127 no more
+// command lines are started.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "/c/cs323/Hwk6/parse.h"
+#include "bash.h"
+
+#define HEADROOM  2048           // Bytes of ARG_MAX left unused (as POSIX)
+#define ARG_STRLEN  (32 * sysconf(_SC_PAGESIZE))   // Longest argument (Linux)
+
+typedef struct {                 // Standard input of xargs
+    char *text;                  // Contents (mapped or malloc()ed)
+    size_t n;
+    bool mapped;
+    off_t start;                 // Offset of TEXT in the file (if mapped)
+    size_t slack;                // Bytes mapped before TEXT (page alignment)
+    char *last;                  // Copy of an unterminated last line in a map
+} input;
+
+extern char **environ;
+
+
+
+// Return the number of bytes that string S takes in argv or envp
+static size_t cost (const char *s)
+{
+    return strlen(s) + 1 + sizeof(char *);
+}
+
+
+// Read all of file descriptor FD into *IN; return false on error
+static bool read_input (int fd, input *in)
+{
+    struct stat st;
+    off_t start;
+    *in = (input) { NULL, 0, false, 0, 0, NULL };
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)
+          && (start = lseek(fd, 0, SEEK_CUR)) >= 0 && start < st.st_size) {
+        off_t base = start & ~((off_t) sysconf(_SC_PAGESIZE) - 1);
+        char *p = mmap(NULL, st.st_size - base, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE, fd, base);
+        if (p != MAP_FAILED) {
+            *in = (input) { p + (start - base), st.st_size - start, true,
+                            start, start - base, NULL };
+            return true;
+        }
+    }
+
+    size_t max = 0;
+    ssize_t got;
+    do {
+        if (in->n + BUFSIZ + 1 > max) {
+            max = (max ? 2 * max : 4 * BUFSIZ);
+            in->text = realloc(in->text, max);
+        }
+        got = read(fd, in->text + in->n, max - in->n - 1);
+        if (got > 0)
+            in->n += got;
+        else if (got < 0 && errno != EINTR) {
+            perror("xargs: read failed");
+            return false;
+        }
+    } while (got != 0);
+    return true;
+}
+
+
+// Move the offset of FD, from which mapped input IN was read, past the first
+// N of the lines in ITEM[] (the lines used) and the empty lines before them
+static void consume (int fd, input *in, char **item, size_t n, size_t nItems)
+{
+    size_t used = in->n;
+    if (n == 0)
+        used = 0;
+    else if (n < nItems)                                // (ITEM[N-1] is not
+        used = item[n-1] + strlen(item[n-1]) + 1 - in->text;    //   IN->LAST)
+    lseek(fd, in->start + used, SEEK_SET);
+}
+
+
+// Split IN into lines in place; return a NULL-terminated array of the
+// nonempty ones and set *N to their number
+static char **split_lines (input *in, size_t *n)
+{
+    char **item = NULL;
+    size_t max = 0;
+    char *p = in->text, *end = in->text + in->n;
+
+    *n = 0;
+    while (p < end) {
+        char *nl = memchr(p, '\n', end - p);
+        if (nl != NULL)
+            *nl = '\0';
+        else if (in->mapped)                            // Map has no room for
+            p = in->last = strndup(p, end - p);         //   a terminator
+        else
+            *end = '\0';                                // Buffer has room
+
+        if (*p) {
+            if (*n + 1 >= max) {
+                max = (max ? 2 * max : 256);
+                item = realloc(item, max * sizeof(char *));
+            }
+            item[(*n)++] = p;
+        }
+        p = (nl ? nl + 1 : end);
+    }
+    if (item)
+        item[*n] = NULL;
+    return item;
+}
+
+
+// Return the number of bytes of ARG_MAX left for the argv of a command with
+// the environment and the local variables of PCMD
+static long arg_space (CMD *pcmd)
+{
+    long space = sysconf(_SC_ARG_MAX);
+    if (space <= 0)
+        space = 128 * 1024;
+    for (char **e = environ; *e; e++)
+        space -= cost(*e);
+    for (int i = 0; i < pcmd->nLocal; i++)
+        space -= strlen(pcmd->locVar[i]) + strlen(pcmd->locVal[i]) + 2 + sizeof(char *);
+    return space - HEADROOM - sizeof(char *);
+}
+
+
+// Start command line ARGV with the local variables of PCMD and standard
+// output OUT; return the child's pid, or -1 on error
+static pid_t spawn (CMD *pcmd, char **argv, int out)
+{
+    CMD job = *pcmd;                                    // (Named for ARGV[0]
+    job.argv = argv;                                    //   by perfFork())
+    pid_t pid = perfFork(&job);
+
+    if (pid < 0)
+        perror("xargs: fork failed");
+    else if (pid == 0) {     // child
+        signal(SIGINT,SIG_DFL);
+        int null = open("/dev/null", O_RDONLY);
+        if (null != -1 && null != 0) {
+            dup2(null, 0);
+            close(null);
+        }
+        if (out != 1) {
+            dup2(out, 1);
+            close(out);
+        }
+        for (int i = 0; i < pcmd->nLocal; i++)
+            setenv(pcmd->locVar[i], pcmd->locVal[i], 1);
+        execvp(argv[0], argv);
+        int missing = (errno == ENOENT);
+        perror(argv[0]);
+        _exit(missing ? 127 : 126);
+    }
+    return pid;
+}
+
+
+// Fold status STATUS (as from waitpid()) of one command line into *RESULT;
+// return false if no more command lines should be started
+static bool account (int status, int *result)
+{
+    int code;
+
+    if (WIFSIGNALED(status))
+        code = 125;
+    else if (WEXITSTATUS(status) == 255)
+        code = 124;
+    else if (WEXITSTATUS(status) == 126 || WEXITSTATUS(status) == 127)
+        code = WEXITSTATUS(status);
+    else
+        code = (WEXITSTATUS(status) != 0 ? 123 : 0);
+
+    if (code > *result)
+        *result = code;
+    return code <= 123;
+}
+
+
+// Execute xargs command PCMD; return its status
+int xargs (CMD *pcmd)
+{
+    long maxArgs = 0, procs = 1;
+    int i;
+
+    for (i = 1; i + 1 < pcmd->argc && pcmd->argv[i][0] == '-'; i += 2) {
+        long *opt = (strcmp(pcmd->argv[i], "-n") == 0 ? &maxArgs
+                   : strcmp(pcmd->argv[i], "-P") == 0 ? &procs : NULL);
+        char *end;
+        if (opt == NULL)
+            break;
+        *opt = strtol(pcmd->argv[i+1], &end, 10);
+        if (*end || end == pcmd->argv[i+1] || *opt < 0 || (opt == &maxArgs && *opt == 0))
+            break;
+    }
+    if (i < pcmd->argc && pcmd->argv[i][0] == '-') {
+        fprintf(stderr, "usage: xargs [-n MAX] [-P PROCS] [command [initial-arg]...]\n");
+        return 1;
+    }
+
+    char *echo[] = { "echo", NULL };                    // Command and initial
+    char **base = (i < pcmd->argc ? pcmd->argv + i : echo);  // args
+    int nBase = (i < pcmd->argc ? pcmd->argc - i : 1);
+
+    // Input and output
+    int in = 0, out = 1;
+    if (pcmd->fromType == RED_IN && (in = open(pcmd->fromFile, O_RDONLY | O_CLOEXEC)) == -1) {
+        perror(pcmd->fromFile);
+        return errno;
+    }
+    if (pcmd->toType != NONE) {
+        int obits = O_CREAT | O_WRONLY | O_CLOEXEC;
+        obits |= (pcmd->toType == RED_APP ? O_APPEND : O_TRUNC);
+        if ((out = open(pcmd->toFile, obits, 0644)) == -1) {
+            perror(pcmd->toFile);
+            if (in != 0)
+                close(in);
+            return errno;
+        }
+    }
+
+    input text;
+    bool ok = read_input(in, &text);
+    size_t nItems = 0;
+    char **item = (ok ? split_lines(&text, &nItems) : NULL);
+
+    // Room for the lines on each command line
+    long space = arg_space(pcmd);
+    for (int j = 0; j < nBase; j++)
+        space -= cost(base[j]);
+
+    char **argv = malloc((nBase + nItems + 1) * sizeof(char *));
+    memcpy(argv, base, nBase * sizeof(char *));
+    pid_t *pids = malloc((procs > 0 ? procs : 1) * sizeof(pid_t));
+    int running = 0, result = (ok ? 0 : 1), status;
+    bool more = ok;
+    size_t next = 0;
+    pid_t pid;
+
+    signal(SIGINT,SIG_IGN);
+    fflush(stdout);
+
+    while ((more && next < nItems) || running > 0) {
+
+        // Start next command line
+        if (more && next < nItems && (procs == 0 || running < procs)) {
+            long room = space;
+            size_t n = 0;
+            while (next + n < nItems && (maxArgs == 0 || (long) n < maxArgs)
+                     && (long) cost(item[next+n]) <= room
+                     && (long) strlen(item[next+n]) < ARG_STRLEN)
+                room -= cost(item[next + n++]);
+            if (n == 0) {
+                fprintf(stderr, "xargs: argument line too long\n");
+                result = (result > 1 ? result : 1);
+                more = false;
+                continue;
+            }
+            memcpy(argv + nBase, item + next, n * sizeof(char *));
+            argv[nBase + n] = NULL;
+            next += n;
+
+            if ((pid = spawn(pcmd, argv, out)) < 0) {
+                result = 126;
+                more = false;
+                continue;
+            }
+            if (procs == 0)
+                pids = realloc(pids, (running + 1) * sizeof(pid_t));
+            pids[running++] = pid;
+            continue;
+        }
+
+        // Wait for one to finish (reporting backgrounded commands as usual)
+        if ((pid = waitpid((pid_t)(-1), &status, 0)) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        int k;
+        for (k = 0; k < running && pids[k] != pid; k++)
+            ;
+        perfReap(pid);
+        if (k < running) {
+            pids[k] = pids[--running];
+            more = account(status, &result) && more;
+        }
+        else {
+            status = (WIFEXITED(status) ? WEXITSTATUS(status) : 128+WTERMSIG(status));
+            fprintf(stderr, "Completed: %d (%d)\n", pid, status);
+            jobReaped(pid);
+        }
+    }
+    signal(SIGINT,SIG_DFL);
+
+    if (text.mapped)
+        consume(in, &text, item, next, nItems);
+    if (in != 0)
+        close(in);
+    if (out != 1)
+        close(out);
+    free(pids);
+    free(argv);
+    free(item);
+    free(text.last);
+    if (text.mapped)
+        munmap(text.text - text.slack, text.n + text.slack);
+    else
+        free(text.text);
+    return result;
+}